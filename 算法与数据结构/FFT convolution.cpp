@@ -3,6 +3,21 @@
 #include<vector>
 #include<math.h>
 #include<string>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<random>
+#include<chrono>
+#include<thread>
+#include<condition_variable>
+#include<functional>
+#include<stdexcept>
+#include<stdint.h>
+#include<limits.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FFT_X86_SIMD
+#include<immintrin.h>
+#endif
 using namespace std;
 
 
@@ -25,6 +40,7 @@ public:
     }
     operator int(){ return round(re);}
     operator double(){ return (double)re;}
+    operator float(){ return (float)re;}
     void Conjugate(){ im = -im; }
     
     template<class T2> friend Complex<T2> operator + (const Complex<T2>& a,const Complex<T2>& b);
@@ -76,119 +92,1825 @@ inline void fill2exp(vector<T>& a,int n=0){
     for (int i=n-a.size()-1;i>=0;--i) a.push_back(T(0));
 }
 
-// regard the coefficients of a[start:end:step] as a new polynomial, 
-// and calculate the fft result given the unit roots
-template<class T2>
-vector<Complex<double>> FFTRecursion(const vector<T2>& a,int start,int end,int step,
-                                    const vector<Complex<double>>& roots){
+// Precomputed tables for the fast fourier transforms of length up to n (an exponential of 2)
+//   rev[i]     : i with its log2(n) bits reversed
+//   roots[m+j] : exp(2 pi i j / 2m), the unit roots of length 2m, for every exponential of 2
+//                m < n and 0 <= j < m (the inverse transform uses their conjugates)
+//   rootre, rootim : the real and imaginary parts of roots, for the split-complex kernels
+// A plan is never modified after construction, so it can be shared read-only by threads
+// A plan of length n also serves every shorter length, since the roots do not depend on n
+// and the bit-reversal of length n/2^s is rev[i << s]
+class FFTPlan{
+public:
+    int n;
+    vector<int> rev;
+    vector<Complex<double>> roots;
+    vector<double> rootre, rootim;
+
+    FFTPlan(int _n):n(_n),rev(_n),roots(_n > 1 ? _n : 1),rootre(roots.size()),rootim(roots.size()){
+        for (int i=1;i<n;++i) rev[i] = (rev[i>>1] >> 1) | ((i & 1) ? n >> 1 : 0);
+        for (int m=1;m<n;m<<=1){
+            for (int j=0;j<m;++j) roots[m+j] = Complex<double>(cos(M_PI*j/m), sin(M_PI*j/m));
+        }
+        for (int i=roots.size()-1;i>=0;--i) rootre[i] = roots[i].re, rootim[i] = roots[i].im;
+    }
+};
 
-    if (start + step >= end) return vector<Complex<double>>({Complex<double>(a[start])});
+// return the plan of length n from a cache keyed by the length, the plan is created at the first call
+// it is safe to call from several threads
+const FFTPlan& GetFFTPlan(int n){
+    static map<int,unique_ptr<FFTPlan>> cache;
+    static mutex lock;
+    lock_guard<mutex> guard(lock);
+    unique_ptr<FFTPlan>& plan = cache[n];
+    if (!plan) plan.reset(new FFTPlan(n));
+    return *plan;
+}
 
-    vector<Complex<double>> ans((end-start-1)/step + 1);
-    vector<Complex<double>> even_coeffs = FFTRecursion(a,start,end-step,step<<1,roots);
-    vector<Complex<double>> odd_coeffs  = FFTRecursion(a,start+step,end,step<<1,roots);
+// iterative in-place fast fourier transform of a[0:n), where n is an exponential of 2
+// and the plan has length at least n
+// set the argument inv = true  to perform inverse fast fourier transform
+// the result is the same as FFT(vector(a, a+n), inv) without any allocation or trigonometry:
+// the input is permuted in bit-reversed order, then every radix-4 stage merges 4 transforms
+// of length m into one of length 4m (with a radix-2 stage first if log2(n) is odd)
+void FFT(Complex<double>* a,int n,const FFTPlan& plan,bool inv = false){
+    int shift = __builtin_ctz(plan.n) - __builtin_ctz(n);
+    for (int i=1;i<n;++i){
+        int j = plan.rev[i << shift];
+        if (i < j) swap(a[i],a[j]);
+    }
 
-    int m = ans.size() >> 1;
-    for (int i=0,j=m,k=0; i<m; ++i,++j,k+=step){
-        ans[i] = even_coeffs[i] + roots[k]*odd_coeffs[i];
-        ans[j] = even_coeffs[i] - roots[k]*odd_coeffs[i];
+    int m = 1;
+    if (__builtin_ctz(n) & 1){
+        for (int i=0;i<n;i+=2){
+            Complex<double> t = a[i+1];
+            a[i+1] = a[i] - t;
+            a[i] += t;
+        }
+        m = 2;
     }
 
-    return ans;
+    const double sign = inv ? -1 : 1;
+    const Complex<double>* roots = plan.roots.data();
+    for (;m<n;m<<=2){
+        for (int k=0;k<n;k+=4*m){
+            for (int j=0;j<m;++j){
+                // w2 is the unit root of length 4m, w1 = w2^2 is that of length 2m
+                Complex<double> w1 = roots[m+j], w2 = roots[2*m+j];
+                if (inv) w1.Conjugate(), w2.Conjugate();
+                Complex<double>* x = a + k + j;
+                Complex<double> a1 = w1 * x[m], a3 = w1 * x[3*m];
+                Complex<double> b0 = x[0] + a1, b1 = x[0] - a1;
+                Complex<double> b2 = x[2*m] + a3, b3 = x[2*m] - a3;
+                b2 *= w2;
+                b3 *= w2;
+                // multiply b3 by the 4th unit root, i.e. i for fft and -i for inverse fft
+                b3 = Complex<double>(-sign*b3.im, sign*b3.re);
+                x[0]   = b0 + b2;
+                x[2*m] = b0 - b2;
+                x[m]   = b1 + b3;
+                x[3*m] = b1 - b3;
+            }
+        }
+    }
+
+    if (inv){
+        for (int i=0;i<n;++i) a[i] /= n;
+    }
+}
+
+// same as above, with the plan looked up from the cache
+inline void FFT(Complex<double>* a,int n,bool inv = false){
+    FFT(a,n,GetFFTPlan(n),inv);
+}
+
+
+//********************************************************
+//          Split-Complex FFT with SIMD Kernels
+//********************************************************
+
+// The split-complex transforms store the real parts and the imaginary parts of a[0:n)
+// in two arrays re[0:n) and im[0:n), so that the butterflies of 4 (AVX2) or 8 (AVX-512)
+// consecutive j are computed by one vector instruction. The algorithm is the same as
+// FFT(Complex<double>* a, ...) above, and the kernel is chosen by the cpu at runtime
+
+// bit-reversal permutation and the first stage, where all the unit roots are 1:
+// radix-2 if log2(n) is odd, otherwise radix-4
+// return the length of the transforms merged by the next stage
+inline int FFTSplitPrologue(double* re,double* im,int n,const FFTPlan& plan,double sign){
+    int shift = __builtin_ctz(plan.n) - __builtin_ctz(n);
+    for (int i=1;i<n;++i){
+        int j = plan.rev[i << shift];
+        if (i < j) swap(re[i],re[j]), swap(im[i],im[j]);
+    }
+    if (n == 1) return 1;
+    if (__builtin_ctz(n) & 1){
+        for (int i=0;i<n;i+=2){
+            double tr = re[i+1], ti = im[i+1];
+            re[i+1] = re[i] - tr, im[i+1] = im[i] - ti;
+            re[i] += tr, im[i] += ti;
+        }
+        return 2;
+    }
+    for (int i=0;i<n;i+=4){
+        double* xr = re + i;
+        double* xi = im + i;
+        double b0r = xr[0] + xr[1], b0i = xi[0] + xi[1], b1r = xr[0] - xr[1], b1i = xi[0] - xi[1];
+        double b2r = xr[2] + xr[3], b2i = xi[2] + xi[3];
+        double b3r = -sign*(xi[2] - xi[3]), b3i = sign*(xr[2] - xr[3]);
+        xr[0] = b0r + b2r, xi[0] = b0i + b2i;
+        xr[2] = b0r - b2r, xi[2] = b0i - b2i;
+        xr[1] = b1r + b3r, xi[1] = b1i + b3i;
+        xr[3] = b1r - b3r, xi[3] = b1i - b3i;
+    }
+    return 4;
+}
+
+// radix-4 butterflies merging 4 transforms of length m at xr, xi, for j in [j0, m)
+// sign = 1 for fft and -1 for inverse fft, where the roots are conjugated
+inline void FFTRadix4Scalar(double* xr,double* xi,int m,int j0,const FFTPlan& plan,double sign){
+    const double* wr = plan.rootre.data();
+    const double* wi = plan.rootim.data();
+    for (int j=j0;j<m;++j){
+        double w1r = wr[m+j], w1i = sign*wi[m+j], w2r = wr[2*m+j], w2i = sign*wi[2*m+j];
+        double a1r = w1r*xr[j+m]   - w1i*xi[j+m],   a1i = w1r*xi[j+m]   + w1i*xr[j+m];
+        double a3r = w1r*xr[j+3*m] - w1i*xi[j+3*m], a3i = w1r*xi[j+3*m] + w1i*xr[j+3*m];
+        double b0r = xr[j] + a1r, b0i = xi[j] + a1i, b1r = xr[j] - a1r, b1i = xi[j] - a1i;
+        double c2r = xr[j+2*m] + a3r, c2i = xi[j+2*m] + a3i;
+        double c3r = xr[j+2*m] - a3r, c3i = xi[j+2*m] - a3i;
+        double b2r = w2r*c2r - w2i*c2i, b2i = w2r*c2i + w2i*c2r;
+        // multiply by w2 and the 4th unit root, i.e. i for fft and -i for inverse fft
+        double b3r = -sign*(w2r*c3i + w2i*c3r), b3i = sign*(w2r*c3r - w2i*c3i);
+        xr[j]     = b0r + b2r, xi[j]     = b0i + b2i;
+        xr[j+2*m] = b0r - b2r, xi[j+2*m] = b0i - b2i;
+        xr[j+m]   = b1r + b3r, xi[j+m]   = b1i + b3i;
+        xr[j+3*m] = b1r - b3r, xi[j+3*m] = b1i - b3i;
+    }
+}
+
+inline void FFTSplitEpilogue(double* re,double* im,int n,bool inv){
+    if (!inv) return;
+    double scale = 1.0 / n;
+    for (int i=0;i<n;++i) re[i] *= scale, im[i] *= scale;
+}
+
+// portable kernel
+void FFTSplitScalar(double* re,double* im,int n,const FFTPlan& plan,bool inv){
+    double sign = inv ? -1 : 1;
+    for (int m=FFTSplitPrologue(re,im,n,plan,sign);m<n;m<<=2){
+        for (int k=0;k<n;k+=4*m) FFTRadix4Scalar(re+k,im+k,m,0,plan,sign);
+    }
+    FFTSplitEpilogue(re,im,n,inv);
+}
+
+#ifdef FFT_X86_SIMD
+// radix-4 butterflies of 4 consecutive j by AVX2, the arguments are the same as FFTRadix4Scalar
+// s = sign and ns = -sign in all the lanes
+__attribute__((target("avx2,fma"))) inline
+void FFTRadix4AVX2(double* xr,double* xi,int m,int j,const double* wr,const double* wi,__m256d s,__m256d ns){
+    __m256d w1r = _mm256_loadu_pd(wr+m+j),   w1i = _mm256_mul_pd(s,_mm256_loadu_pd(wi+m+j));
+    __m256d w2r = _mm256_loadu_pd(wr+2*m+j), w2i = _mm256_mul_pd(s,_mm256_loadu_pd(wi+2*m+j));
+    __m256d x0r = _mm256_loadu_pd(xr+j),     x0i = _mm256_loadu_pd(xi+j);
+    __m256d x1r = _mm256_loadu_pd(xr+j+m),   x1i = _mm256_loadu_pd(xi+j+m);
+    __m256d x2r = _mm256_loadu_pd(xr+j+2*m), x2i = _mm256_loadu_pd(xi+j+2*m);
+    __m256d x3r = _mm256_loadu_pd(xr+j+3*m), x3i = _mm256_loadu_pd(xi+j+3*m);
+    __m256d a1r = _mm256_fmsub_pd(w1r,x1r,_mm256_mul_pd(w1i,x1i));
+    __m256d a1i = _mm256_fmadd_pd(w1r,x1i,_mm256_mul_pd(w1i,x1r));
+    __m256d a3r = _mm256_fmsub_pd(w1r,x3r,_mm256_mul_pd(w1i,x3i));
+    __m256d a3i = _mm256_fmadd_pd(w1r,x3i,_mm256_mul_pd(w1i,x3r));
+    __m256d b0r = _mm256_add_pd(x0r,a1r), b0i = _mm256_add_pd(x0i,a1i);
+    __m256d b1r = _mm256_sub_pd(x0r,a1r), b1i = _mm256_sub_pd(x0i,a1i);
+    __m256d c2r = _mm256_add_pd(x2r,a3r), c2i = _mm256_add_pd(x2i,a3i);
+    __m256d c3r = _mm256_sub_pd(x2r,a3r), c3i = _mm256_sub_pd(x2i,a3i);
+    __m256d b2r = _mm256_fmsub_pd(w2r,c2r,_mm256_mul_pd(w2i,c2i));
+    __m256d b2i = _mm256_fmadd_pd(w2r,c2i,_mm256_mul_pd(w2i,c2r));
+    __m256d b3r = _mm256_mul_pd(ns,_mm256_fmadd_pd(w2r,c3i,_mm256_mul_pd(w2i,c3r)));
+    __m256d b3i = _mm256_mul_pd(s,_mm256_fmsub_pd(w2r,c3r,_mm256_mul_pd(w2i,c3i)));
+    _mm256_storeu_pd(xr+j,     _mm256_add_pd(b0r,b2r)), _mm256_storeu_pd(xi+j,     _mm256_add_pd(b0i,b2i));
+    _mm256_storeu_pd(xr+j+2*m, _mm256_sub_pd(b0r,b2r)), _mm256_storeu_pd(xi+j+2*m, _mm256_sub_pd(b0i,b2i));
+    _mm256_storeu_pd(xr+j+m,   _mm256_add_pd(b1r,b3r)), _mm256_storeu_pd(xi+j+m,   _mm256_add_pd(b1i,b3i));
+    _mm256_storeu_pd(xr+j+3*m, _mm256_sub_pd(b1r,b3r)), _mm256_storeu_pd(xi+j+3*m, _mm256_sub_pd(b1i,b3i));
+}
+
+// radix-4 butterflies of 8 consecutive j by AVX-512
+__attribute__((target("avx512f"))) inline
+void FFTRadix4AVX512(double* xr,double* xi,int m,int j,const double* wr,const double* wi,__m512d s,__m512d ns){
+    __m512d w1r = _mm512_loadu_pd(wr+m+j),   w1i = _mm512_mul_pd(s,_mm512_loadu_pd(wi+m+j));
+    __m512d w2r = _mm512_loadu_pd(wr+2*m+j), w2i = _mm512_mul_pd(s,_mm512_loadu_pd(wi+2*m+j));
+    __m512d x0r = _mm512_loadu_pd(xr+j),     x0i = _mm512_loadu_pd(xi+j);
+    __m512d x1r = _mm512_loadu_pd(xr+j+m),   x1i = _mm512_loadu_pd(xi+j+m);
+    __m512d x2r = _mm512_loadu_pd(xr+j+2*m), x2i = _mm512_loadu_pd(xi+j+2*m);
+    __m512d x3r = _mm512_loadu_pd(xr+j+3*m), x3i = _mm512_loadu_pd(xi+j+3*m);
+    __m512d a1r = _mm512_fmsub_pd(w1r,x1r,_mm512_mul_pd(w1i,x1i));
+    __m512d a1i = _mm512_fmadd_pd(w1r,x1i,_mm512_mul_pd(w1i,x1r));
+    __m512d a3r = _mm512_fmsub_pd(w1r,x3r,_mm512_mul_pd(w1i,x3i));
+    __m512d a3i = _mm512_fmadd_pd(w1r,x3i,_mm512_mul_pd(w1i,x3r));
+    __m512d b0r = _mm512_add_pd(x0r,a1r), b0i = _mm512_add_pd(x0i,a1i);
+    __m512d b1r = _mm512_sub_pd(x0r,a1r), b1i = _mm512_sub_pd(x0i,a1i);
+    __m512d c2r = _mm512_add_pd(x2r,a3r), c2i = _mm512_add_pd(x2i,a3i);
+    __m512d c3r = _mm512_sub_pd(x2r,a3r), c3i = _mm512_sub_pd(x2i,a3i);
+    __m512d b2r = _mm512_fmsub_pd(w2r,c2r,_mm512_mul_pd(w2i,c2i));
+    __m512d b2i = _mm512_fmadd_pd(w2r,c2i,_mm512_mul_pd(w2i,c2r));
+    __m512d b3r = _mm512_mul_pd(ns,_mm512_fmadd_pd(w2r,c3i,_mm512_mul_pd(w2i,c3r)));
+    __m512d b3i = _mm512_mul_pd(s,_mm512_fmsub_pd(w2r,c3r,_mm512_mul_pd(w2i,c3i)));
+    _mm512_storeu_pd(xr+j,     _mm512_add_pd(b0r,b2r)), _mm512_storeu_pd(xi+j,     _mm512_add_pd(b0i,b2i));
+    _mm512_storeu_pd(xr+j+2*m, _mm512_sub_pd(b0r,b2r)), _mm512_storeu_pd(xi+j+2*m, _mm512_sub_pd(b0i,b2i));
+    _mm512_storeu_pd(xr+j+m,   _mm512_add_pd(b1r,b3r)), _mm512_storeu_pd(xi+j+m,   _mm512_add_pd(b1i,b3i));
+    _mm512_storeu_pd(xr+j+3*m, _mm512_sub_pd(b1r,b3r)), _mm512_storeu_pd(xi+j+3*m, _mm512_sub_pd(b1i,b3i));
+}
+
+// AVX2 kernel, the stage with m = 2 falls back to the scalar butterflies
+__attribute__((target("avx2,fma")))
+void FFTSplitAVX2(double* re,double* im,int n,const FFTPlan& plan,bool inv){
+    double sign = inv ? -1 : 1;
+    const double* wr = plan.rootre.data();
+    const double* wi = plan.rootim.data();
+    const __m256d s = _mm256_set1_pd(sign), ns = _mm256_set1_pd(-sign);
+    for (int m=FFTSplitPrologue(re,im,n,plan,sign);m<n;m<<=2){
+        for (int k=0;k<n;k+=4*m){
+            if (m < 4) FFTRadix4Scalar(re+k,im+k,m,0,plan,sign);
+            else for (int j=0;j<m;j+=4) FFTRadix4AVX2(re+k,im+k,m,j,wr,wi,s,ns);
+        }
+    }
+    FFTSplitEpilogue(re,im,n,inv);
+}
+
+// AVX-512 kernel, the stage with m = 4 uses AVX2 and m = 2 falls back to the scalar butterflies
+__attribute__((target("avx512f,avx2,fma")))
+void FFTSplitAVX512(double* re,double* im,int n,const FFTPlan& plan,bool inv){
+    double sign = inv ? -1 : 1;
+    const double* wr = plan.rootre.data();
+    const double* wi = plan.rootim.data();
+    const __m256d s4 = _mm256_set1_pd(sign), ns4 = _mm256_set1_pd(-sign);
+    const __m512d s8 = _mm512_set1_pd(sign), ns8 = _mm512_set1_pd(-sign);
+    for (int m=FFTSplitPrologue(re,im,n,plan,sign);m<n;m<<=2){
+        for (int k=0;k<n;k+=4*m){
+            if (m < 4) FFTRadix4Scalar(re+k,im+k,m,0,plan,sign);
+            else if (m < 8) FFTRadix4AVX2(re+k,im+k,m,0,wr,wi,s4,ns4);
+            else for (int j=0;j<m;j+=8) FFTRadix4AVX512(re+k,im+k,m,j,wr,wi,s8,ns8);
+        }
+    }
+    FFTSplitEpilogue(re,im,n,inv);
+}
+#endif
+
+typedef void (*FFTSplitKernel)(double*,double*,int,const FFTPlan&,bool);
+
+// choose the widest kernel supported by the cpu
+FFTSplitKernel SelectFFTSplitKernel(){
+#ifdef FFT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return FFTSplitAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return FFTSplitAVX2;
+#endif
+    return FFTSplitScalar;
+}
+
+// split-complex fast fourier transform of (re + i im)[0:n), n is an exponential of 2
+// and the plan has length at least n
+void FFT(double* re,double* im,int n,const FFTPlan& plan,bool inv = false){
+    static const FFTSplitKernel kernel = SelectFFTSplitKernel();
+    kernel(re,im,n,plan,inv);
+}
+
+
+//********************************************************
+//              Parallel Six-Step FFT
+//********************************************************
+
+// A minimal fork-join thread pool
+// run(f) calls f(tid, size()) on every thread (the calling thread is tid 0) and waits for all of them
+class ThreadPool{
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable start, done;
+    function<void(int,int)> task;
+    int generation = 0, pending = 0;
+    bool stop = false;
+
+public:
+    ThreadPool(int n){
+        for (int tid=1;tid<n;++tid){
+            workers.emplace_back([this,tid](){
+                int seen = 0;
+                while (1){
+                    unique_lock<mutex> lock(mtx);
+                    start.wait(lock,[&](){ return stop || generation != seen;});
+                    if (stop) return;
+                    seen = generation;
+                    lock.unlock();
+                    task(tid,size());
+                    lock.lock();
+                    if (--pending == 0) done.notify_one();
+                }
+            });
+        }
+    }
+    ~ThreadPool(){
+        {
+            lock_guard<mutex> lock(mtx);
+            stop = true;
+        }
+        start.notify_all();
+        for (thread& t: workers) t.join();
+    }
+    int size() const{ return workers.size() + 1;}
+    void run(const function<void(int,int)>& f){
+        {
+            lock_guard<mutex> lock(mtx);
+            task = f;
+            pending = workers.size();
+            ++generation;
+        }
+        start.notify_all();
+        f(0,size());
+        unique_lock<mutex> lock(mtx);
+        done.wait(lock,[&](){ return pending == 0;});
+    }
+};
+
+// (tre, tim) = the transposes of (re, im), rows x cols matrices stored by rows
+// the tiles of 32 x 32 are shared by the threads of the pool, and every tile is written
+// by columns of src, i.e. contiguously in dst
+// ld and tld are the distances between the rows of src and dst (cols and rows by default),
+// since the rows of a tile conflict in the cache if the distance is an exponential of 2
+void ParallelTranspose(ThreadPool& pool,const double* re,const double* im,double* tre,double* tim,int rows,int cols,
+                       int ld = 0,int tld = 0){
+    const int B = 32;
+    if (!ld) ld = cols;
+    if (!tld) tld = rows;
+    int tiles = (rows + B - 1) / B;
+    pool.run([&](int tid,int nt){
+        for (int t=tid;t<tiles;t+=nt){
+            int r0 = t * B, r1 = min(rows,r0 + B);
+            for (int c0=0;c0<cols;c0+=B){
+                int c1 = min(cols,c0 + B);
+                for (int c=c0;c<c1;++c)
+                    for (int r=r0;r<r1;++r) tre[(size_t)c*tld + r] = re[(size_t)r*ld + c];
+                for (int c=c0;c<c1;++c)
+                    for (int r=r0;r<r1;++r) tim[(size_t)c*tld + r] = im[(size_t)r*ld + c];
+            }
+        }
+    });
+}
+
+// The parallel fast fourier transform of (re + i im)[0:n), n is an exponential of 2, by the
+// four-step (or six-step) decomposition. With n = n1 n2 and j = j1 + n1 j2, the input is a
+// n2 x n1 matrix stored by rows, and
+//      X[k2 + n2 k1] = sum_j1 w1^(j1 k1) w^(j1 k2) sum_j2 w2^(j2 k2) x[j1 + n1 j2]
+// where w, w1, w2 are the unit roots of length n, n1, n2, so it is computed by
+//   1. the transforms of length n2 on the columns, multiplied by the twiddle factors w^(j1 k2)
+//   2. the transforms of length n1 on the rows
+//   3. the transpose to n1 x n2
+// The columns are gathered in blocks of 8 into a buffer of every thread, which plays the part of
+// the first two transposes of the six-step algorithm without passes over the whole array.
+// Every transform of length about sqrt(n) fits in the cache and the blocks and the rows are shared
+// by the threads of the pool. The twiddle factors w^t are the products lo[t mod s] hi[t / s] of
+// two tables of length about sqrt(n), instead of a plan of length n
+// The result equals FFT(re, im, n, plan, inv) up to rounding
+void ParallelFFT(double* re,double* im,int n,ThreadPool& pool,bool inv = false){
+    int lg = __builtin_ctz(n);
+    if (lg < 6){
+        FFT(re,im,n,GetFFTPlan(n),inv);
+        return;
+    }
+    int n2 = 1 << (lg / 2), n1 = n / n2;
+    const FFTPlan& plan = GetFFTPlan(n1);
+
+    int ls = (lg + 1) / 2, s = 1 << ls;
+    double sign = inv ? -1 : 1;
+    vector<double> lore(s), loim(s), hire(n >> ls), hiim(n >> ls);
+    for (int a=0;a<s;++a) lore[a] = cos(2*M_PI*a/n), loim[a] = sign*sin(2*M_PI*a/n);
+    for (int b=0;b<(n>>ls);++b) hire[b] = cos(2*M_PI*b*s/n), hiim[b] = sign*sin(2*M_PI*b*s/n);
+
+    const int W = 8;
+    pool.run([&](int tid,int nt){
+        vector<double> colre(W * n2), colim(W * n2);
+        for (int j0=W*tid;j0<n1;j0+=W*nt){
+            for (int j2=0;j2<n2;++j2){
+                const double* xr = re + (size_t)j2*n1 + j0;
+                const double* xi = im + (size_t)j2*n1 + j0;
+                for (int c=0;c<W;++c) colre[c*n2 + j2] = xr[c], colim[c*n2 + j2] = xi[c];
+            }
+            for (int c=0;c<W;++c){
+                double* xr = colre.data() + c*n2;
+                double* xi = colim.data() + c*n2;
+                FFT(xr,xi,n2,plan,inv);
+                for (int k2=1,t=j0+c;k2<n2;++k2,t+=j0+c){
+                    double wr = lore[t & (s-1)]*hire[t >> ls] - loim[t & (s-1)]*hiim[t >> ls];
+                    double wi = lore[t & (s-1)]*hiim[t >> ls] + loim[t & (s-1)]*hire[t >> ls];
+                    double r = xr[k2]*wr - xi[k2]*wi;
+                    xi[k2] = xr[k2]*wi + xi[k2]*wr;
+                    xr[k2] = r;
+                }
+            }
+            for (int k2=0;k2<n2;++k2){
+                double* xr = re + (size_t)k2*n1 + j0;
+                double* xi = im + (size_t)k2*n1 + j0;
+                for (int c=0;c<W;++c) xr[c] = colre[c*n2 + k2], xi[c] = colim[c*n2 + k2];
+            }
+        }
+    });
+    pool.run([&](int tid,int nt){
+        for (int k2=(long long)n2*tid/nt;k2<(long long)n2*(tid+1)/nt;++k2){
+            FFT(re + (size_t)k2*n1,im + (size_t)k2*n1,n1,plan,inv);
+        }
+    });
+
+    unique_ptr<double[]> bufre(new double[n]), bufim(new double[n]);
+    ParallelTranspose(pool,re,im,bufre.get(),bufim.get(),n2,n1);
+    pool.run([&](int tid,int nt){
+        size_t l = (size_t)n*tid/nt, r = (size_t)n*(tid+1)/nt;
+        copy(bufre.get() + l,bufre.get() + r,re + l);
+        copy(bufim.get() + l,bufim.get() + r,im + l);
+    });
+}
+
+// same as above with a pool of the given number of threads (all the cores by default)
+inline void ParallelFFT(double* re,double* im,int n,bool inv = false,int threads = 0){
+    ThreadPool pool(threads > 0 ? threads : max(1u,thread::hardware_concurrency()));
+    ParallelFFT(re,im,n,pool,inv);
+}
+
+
+//********************************************************
+//        Mixed-Radix and Bluestein FFT (any length)
+//********************************************************
+
+// Precomputed tables for the fast fourier transform of length n exactly
+// If n = r N with r = 3^b 5^c and N = 2^a, the indices j = j2 + N j1 and k = r k2 + k1 split it:
+//      X[r k2 + k1] = sum_j2 w_N^(j2 k2) w^(j2 k1) sum_j1 w_r^(j1 k1) x[j2 + N j1]
+// so the N transforms of length r (over the r blocks of x) are computed by the Stockham
+// algorithm with radices 3 and 5, and the r transforms of length N by the split-complex kernels:
+//   block   : the transforms of length r are computed for this many columns j2 at a time
+//   radices : the radix p of every Stockham stage
+//   twiddle : from twiddle[stage], w_l^(j t) for 0 <= j < l/p and 0 <= t < p in this order,
+//             where l is the length of the sequences of the stage and w_l = exp(2 pi i / l)
+//   rootre, rootim : w^(k1 j2) for the multiples j2 of block at k1 N / block + j2 / block,
+//   steproot       : and w^(k1 q) for 0 <= q < block at k1 block + q, whose products are the
+//                    twiddle factors between the two steps, where w = exp(2 pi i / n)
+// Otherwise by Bluestein's algorithm, which turns the transform into a convolution of length
+// m = upper2exp(2n - 1) by jk = (j^2 + k^2 - (k-j)^2) / 2:
+//   chirpre, chirpim : c[j] = w^(j^2 / 2), for 0 <= j < n
+//   spectrum : the transforms of length m of conj(c[t]) and c[t] for |t| < n (for the
+//              forward and the inverse transform), where the index -t is stored at m - t
+// As FFTPlan, a plan is read-only after construction
+class MixedRadixPlan{
+public:
+    int n, r, m, block;
+    const FFTPlan* plan;            // the plan of length N, or m for Bluestein's algorithm
+    vector<int> radices, twiddle;
+    vector<double> twiddlere, twiddleim;
+    vector<double> rootre, rootim, steprootre, steprootim;
+    vector<double> chirpre, chirpim;
+    vector<double> spectrum[4];     // the real and the imaginary parts for forward, inverse
+
+    MixedRadixPlan(int _n):n(_n),r(1),m(0),block(1){
+        int rest = n;
+        while (rest % 2 == 0) rest /= 2;
+        while (rest % 3 == 0) radices.push_back(3), rest /= 3, r *= 3;
+        while (rest % 5 == 0) radices.push_back(5), rest /= 5, r *= 5;
+        if (rest == 1){
+            int N = n / r;
+            plan = &GetFFTPlan(N);
+            if (r == 1) return;
+            block = min(N,64);
+            for (int k1=0;k1<r;++k1){
+                for (int j2=0;j2<N;j2+=block){
+                    double theta = 2 * M_PI * ((long long)k1 * j2) / n;
+                    rootre.push_back(cos(theta)), rootim.push_back(sin(theta));
+                }
+                for (int q=0;q<block;++q){
+                    double theta = 2 * M_PI * (k1 * q) / n;
+                    steprootre.push_back(cos(theta)), steprootim.push_back(sin(theta));
+                }
+            }
+            for (int i=0,s=N;i<(int)radices.size();s*=radices[i++]){
+                int p = radices[i], l = n / s;
+                twiddle.push_back(twiddlere.size());
+                for (int j=0;j<l/p;++j){
+                    for (int t=0;t<p;++t){
+                        twiddlere.push_back(cos(2 * M_PI * j * t / l));
+                        twiddleim.push_back(sin(2 * M_PI * j * t / l));
+                    }
+                }
+            }
+            return;
+        }
+        radices.clear(), r = 1;
+
+        m = upper2exp(2 * n - 1);
+        plan = &GetFFTPlan(m);
+        chirpre.resize(n), chirpim.resize(n);
+        for (long long j=0;j<n;++j){
+            double theta = M_PI * (j * j % (2 * n)) / n;  // j^2 mod 2n keeps the angle accurate
+            chirpre[j] = cos(theta), chirpim[j] = sin(theta);
+        }
+        for (int d=0;d<2;++d){
+            vector<double>& re = spectrum[2*d];
+            vector<double>& im = spectrum[2*d+1];
+            re.assign(m,0), im.assign(m,0);
+            double sign = d ? 1 : -1;
+            for (int t=0;t<n;++t){
+                re[t] = chirpre[t], im[t] = sign * chirpim[t];
+                if (t) re[m-t] = re[t], im[m-t] = im[t];
+            }
+            FFT(re.data(),im.data(),m,*plan);
+        }
+    }
+};
+
+// return the mixed-radix plan of length n from a cache, the plan is created at the first call
+// it is safe to call from several threads
+const MixedRadixPlan& GetMixedRadixPlan(int n){
+    static map<int,unique_ptr<MixedRadixPlan>> cache;
+    static mutex lock;
+    lock_guard<mutex> guard(lock);
+    unique_ptr<MixedRadixPlan>& plan = cache[n];
+    if (!plan) plan.reset(new MixedRadixPlan(n));
+    return *plan;
+}
+
+// One Stockham stage of radix P: the sequences of length l = P mp (s interleaved sequences of
+// stride s) are cut into P parts x_k[q] = x[q + s (j + k mp)], and
+//      y[q + s (P j + t)] = w_l^(j t) sum_k x_k w_P^(k t)
+// then the next stage takes y with stride s P. The output is in natural order at the end
+// portable kernel
+template<int P>
+void StockhamStageScalar(const double* __restrict xr,const double* __restrict xi,double* __restrict yr,
+                   double* __restrict yi,int s,int mp,const double* twr,const double* twi,double sign){
+    const double s3 = sign * sqrt(3.0) / 2;
+    const double c51 = cos(2*M_PI/5), c52 = cos(4*M_PI/5);
+    const double s51 = sign * sin(2*M_PI/5), s52 = sign * sin(4*M_PI/5);
+    for (int j=0;j<mp;++j){
+        // the parts x_k and the outputs of this j, and the twiddle factors w_l^(j t)
+        const double *x_r[P], *x_i[P];
+        double *y_r[P], *y_i[P], w_r[P], w_i[P];
+        for (int k=0;k<P;++k){
+            x_r[k] = xr + (size_t)s*(j + k*mp), x_i[k] = xi + (size_t)s*(j + k*mp);
+            y_r[k] = yr + (size_t)s*(P*j + k), y_i[k] = yi + (size_t)s*(P*j + k);
+            w_r[k] = twr[j*P + k], w_i[k] = sign * twi[j*P + k];
+        }
+        for (int q=0;q<s;++q){
+            double ar[P], ai[P], br[P], bi[P];
+            for (int k=0;k<P;++k) ar[k] = x_r[k][q], ai[k] = x_i[k][q];
+            if (P == 3){
+                double sr = ar[1] + ar[2], si = ai[1] + ai[2];
+                double dr = ar[1] - ar[2], di = ai[1] - ai[2];
+                double mr = ar[0] - sr/2, mi = ai[0] - si/2;
+                br[0] = ar[0] + sr,   bi[0] = ai[0] + si;
+                br[1] = mr - s3*di,   bi[1] = mi + s3*dr;
+                br[2] = mr + s3*di,   bi[2] = mi - s3*dr;
+            }else{
+                double s14r = ar[1] + ar[4], s14i = ai[1] + ai[4];
+                double d14r = ar[1] - ar[4], d14i = ai[1] - ai[4];
+                double s23r = ar[2] + ar[3], s23i = ai[2] + ai[3];
+                double d23r = ar[2] - ar[3], d23i = ai[2] - ai[3];
+                double m1r = ar[0] + c51*s14r + c52*s23r, m1i = ai[0] + c51*s14i + c52*s23i;
+                double m2r = ar[0] + c52*s14r + c51*s23r, m2i = ai[0] + c52*s14i + c51*s23i;
+                // i (s1 d14 + s2 d23) and i (s2 d14 - s1 d23)
+                double n1r = -(s51*d14i + s52*d23i), n1i = s51*d14r + s52*d23r;
+                double n2r = -(s52*d14i - s51*d23i), n2i = s52*d14r - s51*d23r;
+                br[0] = ar[0] + s14r + s23r, bi[0] = ai[0] + s14i + s23i;
+                br[1] = m1r + n1r, bi[1] = m1i + n1i;
+                br[4] = m1r - n1r, bi[4] = m1i - n1i;
+                br[2] = m2r + n2r, bi[2] = m2i + n2i;
+                br[3] = m2r - n2r, bi[3] = m2i - n2i;
+            }
+            y_r[0][q] = br[0], y_i[0][q] = bi[0];
+            for (int t=1;t<P;++t){
+                y_r[t][q] = br[t]*w_r[t] - bi[t]*w_i[t];
+                y_i[t][q] = br[t]*w_i[t] + bi[t]*w_r[t];
+            }
+        }
+    }
+}
+
+#ifdef FFT_X86_SIMD
+// AVX2 kernel on 4 consecutive q, s must be a multiple of 4 (or it falls back to the scalar one)
+template<int P> __attribute__((target("avx2,fma")))
+void StockhamStageAVX2(const double* __restrict xr,const double* __restrict xi,double* __restrict yr,
+                       double* __restrict yi,int s,int mp,const double* twr,const double* twi,double sign){
+    if (s % 4){
+        StockhamStageScalar<P>(xr,xi,yr,yi,s,mp,twr,twi,sign);
+        return;
+    }
+    const __m256d half = _mm256_set1_pd(0.5), s3 = _mm256_set1_pd(sign * sqrt(3.0) / 2);
+    const __m256d c51 = _mm256_set1_pd(cos(2*M_PI/5)), c52 = _mm256_set1_pd(cos(4*M_PI/5));
+    const __m256d s51 = _mm256_set1_pd(sign * sin(2*M_PI/5)), s52 = _mm256_set1_pd(sign * sin(4*M_PI/5));
+    for (int j=0;j<mp;++j){
+        const double *x_r[P], *x_i[P];
+        double *y_r[P], *y_i[P];
+        __m256d w_r[P], w_i[P];
+        for (int k=0;k<P;++k){
+            x_r[k] = xr + (size_t)s*(j + k*mp), x_i[k] = xi + (size_t)s*(j + k*mp);
+            y_r[k] = yr + (size_t)s*(P*j + k), y_i[k] = yi + (size_t)s*(P*j + k);
+            w_r[k] = _mm256_set1_pd(twr[j*P + k]), w_i[k] = _mm256_set1_pd(sign * twi[j*P + k]);
+        }
+        for (int q=0;q<s;q+=4){
+            __m256d ar[P], ai[P], br[P], bi[P];
+            for (int k=0;k<P;++k) ar[k] = _mm256_loadu_pd(x_r[k]+q), ai[k] = _mm256_loadu_pd(x_i[k]+q);
+            if (P == 3){
+                __m256d sr = _mm256_add_pd(ar[1],ar[2]), si = _mm256_add_pd(ai[1],ai[2]);
+                __m256d dr = _mm256_sub_pd(ar[1],ar[2]), di = _mm256_sub_pd(ai[1],ai[2]);
+                __m256d mr = _mm256_fnmadd_pd(half,sr,ar[0]), mi = _mm256_fnmadd_pd(half,si,ai[0]);
+                br[0] = _mm256_add_pd(ar[0],sr),       bi[0] = _mm256_add_pd(ai[0],si);
+                br[1] = _mm256_fnmadd_pd(s3,di,mr),    bi[1] = _mm256_fmadd_pd(s3,dr,mi);
+                br[2] = _mm256_fmadd_pd(s3,di,mr),     bi[2] = _mm256_fnmadd_pd(s3,dr,mi);
+            }else{
+                __m256d s14r = _mm256_add_pd(ar[1],ar[4]), s14i = _mm256_add_pd(ai[1],ai[4]);
+                __m256d d14r = _mm256_sub_pd(ar[1],ar[4]), d14i = _mm256_sub_pd(ai[1],ai[4]);
+                __m256d s23r = _mm256_add_pd(ar[2],ar[3]), s23i = _mm256_add_pd(ai[2],ai[3]);
+                __m256d d23r = _mm256_sub_pd(ar[2],ar[3]), d23i = _mm256_sub_pd(ai[2],ai[3]);
+                __m256d m1r = _mm256_fmadd_pd(c51,s14r,_mm256_fmadd_pd(c52,s23r,ar[0]));
+                __m256d m1i = _mm256_fmadd_pd(c51,s14i,_mm256_fmadd_pd(c52,s23i,ai[0]));
+                __m256d m2r = _mm256_fmadd_pd(c52,s14r,_mm256_fmadd_pd(c51,s23r,ar[0]));
+                __m256d m2i = _mm256_fmadd_pd(c52,s14i,_mm256_fmadd_pd(c51,s23i,ai[0]));
+                // i (s1 d14 + s2 d23) = -u1 + i n1 and i (s2 d14 - s1 d23) = -u2 + i n2
+                __m256d u1 = _mm256_fmadd_pd(s51,d14i,_mm256_mul_pd(s52,d23i));
+                __m256d n1 = _mm256_fmadd_pd(s51,d14r,_mm256_mul_pd(s52,d23r));
+                __m256d u2 = _mm256_fmsub_pd(s52,d14i,_mm256_mul_pd(s51,d23i));
+                __m256d n2 = _mm256_fmsub_pd(s52,d14r,_mm256_mul_pd(s51,d23r));
+                br[0] = _mm256_add_pd(ar[0],_mm256_add_pd(s14r,s23r));
+                bi[0] = _mm256_add_pd(ai[0],_mm256_add_pd(s14i,s23i));
+                br[1] = _mm256_sub_pd(m1r,u1), bi[1] = _mm256_add_pd(m1i,n1);
+                br[4] = _mm256_add_pd(m1r,u1), bi[4] = _mm256_sub_pd(m1i,n1);
+                br[2] = _mm256_sub_pd(m2r,u2), bi[2] = _mm256_add_pd(m2i,n2);
+                br[3] = _mm256_add_pd(m2r,u2), bi[3] = _mm256_sub_pd(m2i,n2);
+            }
+            _mm256_storeu_pd(y_r[0]+q,br[0]), _mm256_storeu_pd(y_i[0]+q,bi[0]);
+            for (int t=1;t<P;++t){
+                _mm256_storeu_pd(y_r[t]+q,_mm256_fmsub_pd(br[t],w_r[t],_mm256_mul_pd(bi[t],w_i[t])));
+                _mm256_storeu_pd(y_i[t]+q,_mm256_fmadd_pd(br[t],w_i[t],_mm256_mul_pd(bi[t],w_r[t])));
+            }
+        }
+    }
+}
+#endif
+
+typedef void (*StockhamKernel)(const double*,const double*,double*,double*,int,int,const double*,const double*,double);
+
+template<int P>
+StockhamKernel SelectStockhamKernel(){
+#ifdef FFT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return StockhamStageAVX2<P>;
+#endif
+    return StockhamStageScalar<P>;
+}
+
+template<int P>
+inline void StockhamStage(const double* xr,const double* xi,double* yr,double* yi,int s,int mp,
+                          const double* twr,const double* twi,double sign){
+    static const StockhamKernel kernel = SelectStockhamKernel<P>();
+    kernel(xr,xi,yr,yi,s,mp,twr,twi,sign);
+}
+
+// fast fourier transform of (re + i im)[0:n) of any length n, where plan.n == n
+// set the argument inv = true  to perform inverse fast fourier transform
+void FFT(double* re,double* im,int n,const MixedRadixPlan& plan,bool inv = false){
+    double sign = inv ? -1 : 1;
+    if (plan.m){
+        // Bluestein: X[k] = c[k] sum_j (x[j] c[j]) conj(c[k-j]), conjugated for the inverse
+        int m = plan.m;
+        vector<double> ur(m,0), ui(m,0);
+        for (int j=0;j<n;++j){
+            double cr = plan.chirpre[j], ci = sign * plan.chirpim[j];
+            ur[j] = re[j]*cr - im[j]*ci;
+            ui[j] = re[j]*ci + im[j]*cr;
+        }
+        FFT(ur.data(),ui.data(),m,*plan.plan);
+        const vector<double>& vr = plan.spectrum[inv ? 2 : 0];
+        const vector<double>& vi = plan.spectrum[inv ? 3 : 1];
+        for (int k=0;k<m;++k){
+            double r = ur[k]*vr[k] - ui[k]*vi[k];
+            ui[k] = ur[k]*vi[k] + ui[k]*vr[k];
+            ur[k] = r;
+        }
+        FFT(ur.data(),ui.data(),m,*plan.plan,true);
+        for (int k=0;k<n;++k){
+            double cr = plan.chirpre[k], ci = sign * plan.chirpim[k];
+            re[k] = ur[k]*cr - ui[k]*ci;
+            im[k] = ur[k]*ci + ui[k]*cr;
+            if (inv) re[k] /= n, im[k] /= n;
+        }
+        return;
+    }
+
+    int r = plan.r, N = n / r;
+    if (r == 1){
+        FFT(re,im,n,*plan.plan,inv);
+        return;
+    }
+    // the transforms of length r: the columns j2 are processed in batches of B, which are copied
+    // into buf as B interleaved sequences, so the Stockham stages run with the strides B, B p, ...
+    // then multiplied by w^(k1 j2) into the rows k1 of work
+    const int B = plan.block;
+    vector<double> workre(n), workim(n);
+    vector<double> bufre(2*r*B), bufim(2*r*B);
+    for (int j0=0;j0<N;j0+=B){
+        double *xr = bufre.data(), *xi = bufim.data(), *yr = xr + r*B, *yi = xi + r*B;
+        for (int j1=0;j1<r;++j1){
+            for (int q=0;q<B;++q){
+                xr[q + B*j1] = re[(size_t)N*j1 + j0 + q];
+                xi[q + B*j1] = im[(size_t)N*j1 + j0 + q];
+            }
+        }
+        for (int i=0,s=B;i<(int)plan.radices.size();s*=plan.radices[i++]){
+            int p = plan.radices[i], mp = r * B / s / p;
+            const double* twr = plan.twiddlere.data() + plan.twiddle[i];
+            const double* twi = plan.twiddleim.data() + plan.twiddle[i];
+            if (p == 3) StockhamStage<3>(xr,xi,yr,yi,s,mp,twr,twi,sign);
+            else StockhamStage<5>(xr,xi,yr,yi,s,mp,twr,twi,sign);
+            swap(xr,yr), swap(xi,yi);
+        }
+        for (int k1=0;k1<r;++k1){
+            double cr = plan.rootre[(size_t)k1*(N/B) + j0/B], ci = sign * plan.rootim[(size_t)k1*(N/B) + j0/B];
+            const double* __restrict wr = plan.steprootre.data() + k1*B;
+            const double* __restrict wi = plan.steprootim.data() + k1*B;
+            const double* __restrict ur = xr + B*k1;
+            const double* __restrict ui = xi + B*k1;
+            double* __restrict zr = workre.data() + (size_t)k1*N + j0;
+            double* __restrict zi = workim.data() + (size_t)k1*N + j0;
+            auto rotate = [&](int q){
+                double vr = cr*wr[q] - sign*ci*wi[q], vi = cr*sign*wi[q] + ci*wr[q];
+                zr[q] = ur[q]*vr - ui[q]*vi;
+                zi[q] = ur[q]*vi + ui[q]*vr;
+            };
+            // the inner loops of the fixed length 4 are vectorized by the compiler
+            if (B % 4) for (int q=0;q<B;++q) rotate(q);
+            else for (int q0=0;q0<B;q0+=4) for (int q=q0;q<q0+4;++q) rotate(q);
+        }
+    }
+    // the transforms of length N on the rows, then X[r k2 + k1] = work[k1 N + k2]
+    for (int k1=0;k1<r;++k1) FFT(workre.data() + (size_t)k1*N,workim.data() + (size_t)k1*N,N,*plan.plan,inv);
+    double scale = inv ? 1.0 / r : 1.0;
+    for (int k2=0;k2<N;++k2){
+        for (int k1=0;k1<r;++k1){
+            re[(size_t)r*k2 + k1] = workre[(size_t)k1*N + k2] * scale;
+            im[(size_t)r*k2 + k1] = workim[(size_t)k1*N + k2] * scale;
+        }
+    }
 }
 
 // fast fourier transform of a polynomial
 // set the argument inv = true  to perform inverse fast fourier transform
+// the length of the transform is len if given (a is padded with zeros, or truncated),
+// otherwise upper2exp(a.size())
 template<class T2>
-vector<Complex<double>> FFT(vector<T2> a,bool inv = false){
-    // guarantee the length is an exponential of 2
-    fill2exp(a);
-    int n = a.size();
+vector<Complex<double>> FFT(const vector<T2>& a,bool inv = false,int len = 0){
+    int n = len ? len : upper2exp(a.size());
+    vector<double> re(n,0), im(n,0);
+    for (int i=min((int)a.size(),n)-1;i>=0;--i){
+        Complex<double> z(a[i]);
+        re[i] = z.re, im[i] = z.im;
+    }
+    if (n & (n - 1)) FFT(re.data(),im.data(),n,GetMixedRadixPlan(n),inv);
+    else FFT(re.data(),im.data(),n,GetFFTPlan(n),inv);
+    vector<Complex<double>> ans(n);
+    for (int i=0;i<n;++i) ans[i] = Complex<double>(re[i],im[i]);
+    return ans;
+}
 
-    vector<Complex<double>> roots(n); // unit roots
-    if (inv){
-        // inverse fft shall use the conjugated unit roots
-        for (int i=n>>1,j=i;i;--i,++j){
-            roots[j] = roots[i] = Complex<double>(cos(2*M_PI*i/n) , sin(2*M_PI*i/n));
-            roots[i].Conjugate();
+
+// Convolution, or Polynomial Multiplication, of real (or integer) sequences by a transform of
+// an even length n >= a.size() + b.size() - 1, the result has length a.size() + b.size() - 1
+// Since a and b are real, they are packed into one complex sequence a + ib and transformed
+// together, then separated by the conjugate symmetry
+//      A[k] = (P[k] + conj(P[n-k])) / 2,    B[k] = (P[k] - conj(P[n-k])) / 2i
+// The product c is real as well, so it is recovered by an inverse transform of length n/2 of
+//      z[j] = c[2j] + i c[2j+1],   Z[k] = (C[k] + C[k+n/2] + i (C[k] - C[k+n/2]) w^-k) / 2
+// where w is the unit root of length n. This costs 1.5 transforms of length n instead of 3
+// plan and half are the plans of length n and n/2, root(k, wr, wi) returns w^-k for k <= n/4
+template<class T,class Plan,class Root>
+vector<T> RealConvolution(const vector<T>& a,const vector<T>& b,int n,const Plan& plan,const Plan& half,Root root){
+    if (a.empty() || b.empty()) return vector<T>();
+    int size = a.size() + b.size() - 1, h = n >> 1;
+    vector<double> re(n,0), im(n,0);
+    for (int i=a.size()-1;i>=0;--i) re[i] = (double)a[i];
+    for (int i=b.size()-1;i>=0;--i) im[i] = (double)b[i];
+    FFT(re.data(),im.data(),n,plan);
+
+    // the product of the spectra at k, computed from P[k] and P[n-k]
+    auto product = [&](int k,double& cr,double& ci){
+        int l = k ? n - k : 0;
+        double pr = re[k], pi = im[k], qr = re[l], qi = -im[l]; // q = conj(P[n-k])
+        double ar = (pr + qr) / 2, ai = (pi + qi) / 2;
+        double br = (pi - qi) / 2, bi = (qr - pr) / 2;
+        cr = ar*br - ai*bi;
+        ci = ar*bi + ai*br;
+    };
+    // Z[k] from C[k] and C[k+h], where w^-(h-k) = -conj(w^-k)
+    auto pack = [&](double wr,double wi,double c0r,double c0i,double c1r,double c1i,double& zr,double& zi){
+        double dr = c0r - c1r, di = c0i - c1i;
+        double er = dr*wr - di*wi, ei = dr*wi + di*wr;
+        zr = (c0r + c1r - ei) / 2;
+        zi = (c0i + c1i + er) / 2;
+    };
+    // the indices k, n-k, h+k, h-k depend on each other, so they are processed together
+    for (int k=0;k<=(h>>1);++k){
+        double ckr, cki, chkr, chki, cmr, cmi, cnr, cni, wr, wi;
+        product(k,ckr,cki);
+        product(h+k,chkr,chki);
+        product(h-k,cmr,cmi);
+        product(k ? n - k : 0,cnr,cni);
+        root(k,wr,wi);
+        double zr, zi, yr, yi;
+        pack(wr,wi,ckr,cki,chkr,chki,zr,zi);
+        if (k && k != h-k) pack(-wr,wi,cmr,cmi,cnr,cni,yr,yi);
+        re[k] = zr, im[k] = zi;
+        if (k && k != h-k) re[h-k] = yr, im[h-k] = yi;
+    }
+    FFT(re.data(),im.data(),h,half,true); // inverse FFT
+
+    vector<T> ans(size);
+    for (int j=(size+1)/2-1;j>=0;--j){
+        ans[2*j] = T(Complex<double>(re[j]));
+        if (2*j+1 < size) ans[2*j+1] = T(Complex<double>(im[j]));
+    }
+    return ans;
+}
+
+// Convolution of real sequences by a transform of length max(4, upper2exp(a.size() + b.size() - 1))
+// the plan must have at least this length
+template<class T>
+vector<T> Convolution(const vector<T>& a,const vector<T>& b,const FFTPlan& plan){
+    int n = max(4,upper2exp( a.size() + b.size() - 1 )), h = n >> 1;
+    return RealConvolution(a,b,n,plan,plan,[&](int k,double& wr,double& wi){
+        wr = plan.rootre[h+k], wi = -plan.rootim[h+k];
+    });
+}
+
+// Convolution of real sequences by a transform of the even length plan.n,
+// which must not be less than a.size() + b.size() - 1
+template<class T>
+vector<T> Convolution(const vector<T>& a,const vector<T>& b,const MixedRadixPlan& plan){
+    int n = plan.n;
+    // w^-k = conj(w^(64 k1) w^k2) for k = 64 k1 + k2
+    vector<double> lore(64), loim(64), hire(n/256+1), hiim(n/256+1);
+    for (int k=0;k<64;++k) lore[k] = cos(2 * M_PI * k / n), loim[k] = sin(2 * M_PI * k / n);
+    for (int k=0;k<=n/256;++k) hire[k] = cos(2 * M_PI * 64 * k / n), hiim[k] = sin(2 * M_PI * 64 * k / n);
+    return RealConvolution(a,b,n,plan,GetMixedRadixPlan(n/2),[&](int k,double& wr,double& wi){
+        double ar = hire[k>>6], ai = hiim[k>>6], br = lore[k&63], bi = loim[k&63];
+        wr = ar*br - ai*bi, wi = -(ar*bi + ai*br);
+    });
+}
+
+
+// Convolution of complex sequences, by 3 transforms of length n >= a.size() + b.size() - 1
+template<class T,class Plan>
+vector<Complex<T>> ComplexConvolution(const vector<Complex<T>>& a,const vector<Complex<T>>& b,int n,const Plan& plan){
+    if (a.empty() || b.empty()) return vector<Complex<T>>();
+    int size = a.size() + b.size() - 1;
+    vector<double> re1(n,0), im1(n,0), re2(n,0), im2(n,0);
+    for (int i=a.size()-1;i>=0;--i) re1[i] = a[i].re, im1[i] = a[i].im;
+    for (int i=b.size()-1;i>=0;--i) re2[i] = b[i].re, im2[i] = b[i].im;
+
+    FFT(re1.data(),im1.data(),n,plan);
+    FFT(re2.data(),im2.data(),n,plan);
+    for (int i=n-1;i>=0;--i){
+        double r = re1[i]*re2[i] - im1[i]*im2[i];
+        im1[i] = re1[i]*im2[i] + im1[i]*re2[i];
+        re1[i] = r;
+    }
+
+    vector<Complex<T>> ans(size);
+    FFT(re1.data(),im1.data(),n,plan,true); // inverse FFT
+    for (int i=size-1;i>=0;--i){
+        ans[i] = Complex<T>(re1[i],im1[i]);
+    }
+    return ans;
+}
+
+template<class T>
+vector<Complex<T>> Convolution(const vector<Complex<T>>& a,const vector<Complex<T>>& b,const FFTPlan& plan){
+    return ComplexConvolution(a,b,upper2exp( a.size() + b.size() - 1 ),plan);
+}
+
+template<class T>
+vector<Complex<T>> Convolution(const vector<Complex<T>>& a,const vector<Complex<T>>& b,const MixedRadixPlan& plan){
+    return ComplexConvolution(a,b,plan.n,plan);
+}
+
+
+// a convolution of the length n = 2^a 3^b 5^c takes about MixedRadixCost + MixedRadixStageCost (b + c)
+// times as long per n log2(n) as the exponentials of 2, since every radix 3 or 5 stage is an extra
+// pass over the data, and MixedRadixShortRowCost more for every halving of the rows 2^a below
+// 1024, whose split-complex transforms are then too short to run at full speed
+double MixedRadixCost = 1.3;
+double MixedRadixStageCost = 0.03;
+double MixedRadixShortRowCost = 0.15;
+
+// the length of the transform for a result of length size: the cheapest by the model above of
+// all the lengths 2^a 3^b 5^c no less than size, with 2^a >= 64 unless b = c = 0 (so the
+// mixed-radix plans keep their blocks of 64 columns, and the lengths are even as needed for
+// the real sequences)
+// the padding is at most 33% for size >= 10^4 (60% for the shorter ones), and about 9% on
+// average, where the exponentials of 2 alone pad up to 100%
+int ConvolutionLength(int size){
+    int best = max(4,upper2exp(size));
+    double cost = best * log2(best);
+    for (long long p3=1,b=0;p3<2LL*size;p3*=3,++b){
+        for (long long r=p3,c=0;r<2LL*size;r*=5,++c){
+            if (r == 1) continue;
+            int rows = max(64,upper2exp((size + r - 1) / r));
+            long long n = r * rows;
+            double factor = MixedRadixCost + MixedRadixStageCost * (b + c)
+                          + MixedRadixShortRowCost * max(0.0,10 - log2(rows));
+            if (n <= INT_MAX && n * log2(n) * factor < cost) best = n, cost = n * log2(n) * factor;
+        }
+    }
+    return best;
+}
+
+// Convolution with the plan looked up from the cache
+template<class T>
+inline vector<T> Convolution(const vector<T>& a,const vector<T>& b){
+    int n = ConvolutionLength(a.size() + b.size() - 1);
+    if (n & (n - 1)) return Convolution(a,b,GetMixedRadixPlan(n));
+    return Convolution(a,b,GetFFTPlan(n));
+}
+
+template<class T>
+inline vector<Complex<T>> Convolution(const vector<Complex<T>>& a,const vector<Complex<T>>& b){
+    int n = ConvolutionLength(a.size() + b.size() - 1);
+    if (n & (n - 1)) return Convolution(a,b,GetMixedRadixPlan(n));
+    return Convolution(a,b,GetFFTPlan(n));
+}
+
+
+
+//********************************************************
+//             2D FFT and Convolution
+//********************************************************
+
+// the transforms of length len of the rows [0:count) of the matrix (re + i im) stored by rows
+// at the distance ld, shared by the threads of the pool
+void FFTRows(ThreadPool& pool,double* re,double* im,int count,int len,int ld,bool inv = false){
+    const MixedRadixPlan& plan = GetMixedRadixPlan(len);
+    pool.run([&](int tid,int nt){
+        for (int i=(long long)count*tid/nt;i<(long long)count*(tid+1)/nt;++i){
+            FFT(re + (size_t)i*ld,im + (size_t)i*ld,len,plan,inv);
+        }
+    });
+}
+
+// the distance between the rows of a matrix with len columns: not an exponential of 2,
+// so that the tiles of ParallelTranspose() do not conflict in the cache
+inline int PaddedStride(int len){
+    return len & (len - 1) ? len : len + 8;
+}
+
+// 2D fast fourier transform of the rows x cols matrix (re + i im) stored by rows, of any sizes
+//      X[k1][k2] = sum_j1 sum_j2 w_rows^(j1 k1) w_cols^(j2 k2) x[j1][j2]
+// The rows are transformed, then the matrix is transposed by tiles so that the columns are
+// transformed as contiguous rows as well, and transposed back
+void FFT2D(double* re,double* im,int rows,int cols,ThreadPool& pool,bool inv = false){
+    int tld = PaddedStride(rows);
+    unique_ptr<double[]> tre(new double[(size_t)cols*tld]), tim(new double[(size_t)cols*tld]);
+    FFTRows(pool,re,im,rows,cols,cols,inv);
+    ParallelTranspose(pool,re,im,tre.get(),tim.get(),rows,cols,cols,tld);
+    FFTRows(pool,tre.get(),tim.get(),cols,rows,tld,inv);
+    ParallelTranspose(pool,tre.get(),tim.get(),re,im,cols,rows,tld,cols);
+}
+
+// same as above with a pool of the given number of threads (all the cores by default)
+inline void FFT2D(double* re,double* im,int rows,int cols,bool inv = false,int threads = 0){
+    ThreadPool pool(threads > 0 ? threads : max(1u,thread::hardware_concurrency()));
+    FFT2D(re,im,rows,cols,pool,inv);
+}
+
+
+// 2D Convolution of real (or integer) matrices a (ra x ca) and b (rb x cb), given by rows
+//      c[i][j] = sum_i1 sum_j1 a[i1][j1] b[i-i1][j-j1],    of (ra + rb - 1) x (ca + cb - 1)
+// As Convolution(), a and b are packed into one complex matrix a + ib of R x C (the lengths of
+// ConvolutionLength()), whose spectrum P gives A[k] = (P[k] + conj(P[-k])) / 2 and
+// B[k] = (P[k] - conj(P[-k])) / 2i, with -k taken modulo R and C, and C[-k] = conj(C[k]).
+// Only the max(ra, rb) nonzero rows are transformed, and the spectrum is kept transposed, so
+// the columns of the inverse transform come first and the whole costs two transposes
+template<class T>
+vector<vector<T>> Convolution2D(const vector<vector<T>>& a,const vector<vector<T>>& b,ThreadPool& pool){
+    int ra = a.size(), rb = b.size(), ca = 0, cb = 0;
+    for (const vector<T>& row: a) ca = max(ca,(int)row.size());
+    for (const vector<T>& row: b) cb = max(cb,(int)row.size());
+    if (!ra || !rb || !ca || !cb) return vector<vector<T>>();
+    int rows = ra + rb - 1, cols = ca + cb - 1;
+    int R = ConvolutionLength(rows), C = ConvolutionLength(cols);
+
+    int ld = PaddedStride(C), tld = PaddedStride(R);
+
+    unique_ptr<double[]> re(new double[(size_t)R*ld]()), im(new double[(size_t)R*ld]());
+    unique_ptr<double[]> tre(new double[(size_t)C*tld]), tim(new double[(size_t)C*tld]);
+    for (int i=0;i<ra;++i){
+        for (int j=a[i].size()-1;j>=0;--j) re[(size_t)i*ld + j] = (double)a[i][j];
+    }
+    for (int i=0;i<rb;++i){
+        for (int j=b[i].size()-1;j>=0;--j) im[(size_t)i*ld + j] = (double)b[i][j];
+    }
+    FFTRows(pool,re.get(),im.get(),max(ra,rb),C,ld);
+    ParallelTranspose(pool,re.get(),im.get(),tre.get(),tim.get(),R,C,ld,tld);
+    FFTRows(pool,tre.get(),tim.get(),C,R,tld);
+
+    // the spectrum P[k1][k2] is at tre[k2 tld + k1]: the row k2 is paired with the row -k2, and
+    // every pair of the entries k and -k is replaced by C[k] and conj(C[k])
+    double* pr = tre.get();
+    double* pi = tim.get();
+    pool.run([&](int tid,int nt){
+        for (int k2=tid;k2<=C/2;k2+=nt){
+            int m2 = k2 ? C - k2 : 0;
+            for (int k1=0;k1<R;++k1){
+                int m1 = k1 ? R - k1 : 0;
+                size_t x = (size_t)k2*tld + k1, y = (size_t)m2*tld + m1;
+                if (k2 == m2 && k1 > m1) continue;
+                double ur = pr[x], ui = pi[x], vr = pr[y], vi = -pi[y];   // v = conj(P[-k])
+                double ar = (ur + vr) / 2, ai = (ui + vi) / 2;
+                double br = (ui - vi) / 2, bi = (vr - ur) / 2;
+                double cr = ar*br - ai*bi, ci = ar*bi + ai*br;
+                pr[x] = cr, pi[x] = ci;
+                pr[y] = cr, pi[y] = -ci;
+            }
+        }
+    });
+
+    FFTRows(pool,tre.get(),tim.get(),C,R,tld,true);
+    ParallelTranspose(pool,tre.get(),tim.get(),re.get(),im.get(),C,R,tld,ld);
+    FFTRows(pool,re.get(),im.get(),rows,C,ld,true);
+
+    vector<vector<T>> ans(rows,vector<T>(cols));
+    for (int i=0;i<rows;++i){
+        for (int j=0;j<cols;++j) ans[i][j] = T(Complex<double>(re[(size_t)i*ld + j]));
+    }
+    return ans;
+}
+
+// same as above with a pool of the given number of threads (all the cores by default)
+template<class T>
+inline vector<vector<T>> Convolution2D(const vector<vector<T>>& a,const vector<vector<T>>& b,int threads = 0){
+    ThreadPool pool(threads > 0 ? threads : max(1u,thread::hardware_concurrency()));
+    return Convolution2D(a,b,pool);
+}
+
+
+
+//********************************************************
+//             Streaming Convolution
+//********************************************************
+
+// Convolution of an unbounded stream x with a fixed real kernel h of length M by overlap-save:
+// every block of length n (an exponential of 2) holds the last M-1 samples of the previous block
+// followed by L = n - M + 1 new samples, and the last L samples of its circular convolution
+// with h are exactly the next L outputs y[t] = sum_k h[k] x[t-k].
+// The spectrum of h is computed once. Since h is real, two blocks x1, x2 are filtered by one
+// pair of transforms of x1 + i x2, whose result is (x1 * h) + i (x2 * h).
+// The memory is O(n) whatever the length of the stream.
+class StreamingConvolver{
+    int m, n, hop;              // the kernel length, the block length, and L
+    bool paired;                // whether two blocks are packed into one transform
+    const FFTPlan* plan;
+    vector<double> hre, him;    // the spectrum of the kernel
+    vector<double> input;       // the last m-1 samples of the previous block, then the pending samples
+    vector<double> re, im;
+
+    // the cost of a transform of length n per output sample, from n log2(n) operations
+    static double Cost(int n,int hop,bool paired){
+        return n * (__builtin_ctz(n) + 1.0) / (hop * (paired ? 2 : 1));
+    }
+
+    // filter the blocks at input[offset:] and (if two) input[offset+hop:], append the outputs to out
+    void Filter(int offset,bool two,vector<double>& out){
+        for (int i=0;i<n;++i){
+            re[i] = input[offset+i];
+            im[i] = two ? input[offset+hop+i] : 0;
+        }
+        FFT(re.data(),im.data(),n,*plan);
+        for (int i=0;i<n;++i){
+            double r = re[i]*hre[i] - im[i]*him[i];
+            im[i] = re[i]*him[i] + im[i]*hre[i];
+            re[i] = r;
+        }
+        FFT(re.data(),im.data(),n,*plan,true);
+        out.insert(out.end(),re.begin()+m-1,re.end());
+        if (two) out.insert(out.end(),im.begin()+m-1,im.end());
+    }
+
+public:
+    // latency = 0 chooses the block length for the throughput, otherwise the block length
+    // with the best throughput such that every output is emitted at most `latency` samples
+    // after its input sample arrives (or the shortest block if none is short enough)
+    StreamingConvolver(const vector<double>& kernel,int latency = 0):m(kernel.size()){
+        int shortest = max(4,upper2exp(m));
+        n = shortest, paired = false;
+        double best = -1;
+        for (int len=shortest;len<=max(shortest,min(1 << 24,shortest << 6));len<<=1){
+            for (int two=0;two<2;++two){
+                int delay = (len - m + 1) * (two ? 2 : 1);
+                if (latency > 0 && delay > latency) continue;
+                double cost = Cost(len,len - m + 1,two);
+                if (best < 0 || cost < best) best = cost, n = len, paired = two;
+            }
+        }
+        hop = n - m + 1;
+        plan = &GetFFTPlan(n);
+        hre.assign(n,0), him.assign(n,0);
+        for (int i=0;i<m;++i) hre[i] = kernel[i];
+        FFT(hre.data(),him.data(),n,*plan);
+        re.resize(n), im.resize(n);
+        input.assign(m - 1,0);
+    }
+
+    int block() const{ return n;}
+    // the number of new samples consumed by one transform
+    int step() const{ return paired ? 2 * hop : hop;}
+
+    // append the chunk to the stream and return the outputs which are complete,
+    // i.e. y[t] for all t up to the last multiple of step() of the samples so far
+    vector<double> process(const vector<double>& chunk){
+        input.insert(input.end(),chunk.begin(),chunk.end());
+        vector<double> out;
+        int offset = 0, pending = input.size() - (m - 1);
+        for (;pending>=step();pending-=step(),offset+=step()) Filter(offset,paired,out);
+        input.erase(input.begin(),input.begin()+offset);
+        return out;
+    }
+
+    // end the stream: return the remaining outputs, including the M-1 samples after the end of
+    // the input, so that all the outputs together are the full convolution of the stream with
+    // the kernel; the convolver is then ready for a new stream
+    vector<double> flush(){
+        int remain = input.size();  // the pending samples and the m-1 samples after them
+        input.resize(2 * remain + 2 * hop,0);
+        vector<double> out;
+        for (int offset=0;(int)out.size()<remain;offset+=2*hop) Filter(offset,true,out);
+        out.resize(remain);
+        input.assign(m - 1,0);
+        return out;
+    }
+};
+
+
+//********************************************************
+//        Number Theoretic Transform (Exact Mode)
+//********************************************************
+
+// Convolution() rounds the result of double precision transforms, which is exact only while
+// the coefficients of a*b are well below 2^53 / n. The number theoretic transform uses the
+// roots of unity modulo a prime p = c 2^k + 1 instead of the complex unit roots, so the
+// product is exact modulo p, and three primes recover the coefficients by the chinese
+// remainder theorem as long as |c[i]| < p1 p2 p3 / 2 (about 3.9e25, or 2^85)
+
+// all of the primes have the primitive root 3, and 2^23 divides every p - 1
+const uint32_t NTTPrimes[3] = {998244353, 167772161, 469762049};
+const int NTTMaxLength = 1 << 23;
+
+// Montgomery arithmetic modulo an odd p < 2^30:
+// mul(a, b) = a b 2^-32 mod p, computed by two multiplications and a shift instead of a division,
+// so mul(a, to(b)) = a b mod p
+// the results are brought into [0, p) by min(r, r - p), where r - p wraps around if r < p,
+// since a branch on random residues is mispredicted half of the time
+class Montgomery{
+public:
+    uint32_t p, pinv, r2;   // pinv = -p^-1 mod 2^32, r2 = 2^64 mod p
+
+    Montgomery(uint32_t _p):p(_p),pinv(_p),r2((uint32_t)(-(uint64_t)_p % _p)){
+        for (int i=0;i<4;++i) pinv *= 2 - p * pinv; // Newton's iteration doubles the correct bits
+        pinv = -pinv;
+    }
+    uint32_t reduce(uint64_t x) const {
+        uint32_t q = (uint32_t)x * pinv;
+        uint32_t r = (x + (uint64_t)q * p) >> 32;
+        return min(r,r - p);
+    }
+    uint32_t mul(uint32_t a,uint32_t b) const { return reduce((uint64_t)a * b); }
+    uint32_t to(uint32_t a) const { return mul(a,r2); }
+    uint32_t add(uint32_t a,uint32_t b) const { a += b; return min(a,a - p); }
+    uint32_t sub(uint32_t a,uint32_t b) const { a = a - b + p; return min(a,a - p); }
+    // a^e mod p, where a is in Montgomery form and so is the result
+    uint32_t pow(uint32_t a,uint32_t e) const {
+        uint32_t r = to(1);
+        for (;e;e>>=1,a=mul(a,a)) if (e & 1) r = mul(r,a);
+        return r;
+    }
+};
+
+// Precomputed tables for the number theoretic transforms modulo p of length up to n
+//   roots[m+j] : w^j, where w is the unit root of length 2m modulo p, for every exponential
+//                of 2 m < n and 0 <= j < m, in Montgomery form
+//   iroots     : the inverses of roots, for the inverse transform
+// As FFTPlan, a plan is read-only after construction and serves every shorter length
+class NTTPlan{
+public:
+    int n;
+    Montgomery mont;
+    vector<uint32_t> roots, iroots;
+
+    NTTPlan(uint32_t p,int _n):n(_n),mont(p),roots(_n > 1 ? _n : 1),iroots(roots.size()){
+        for (int m=1;m<n;m<<=1){
+            uint32_t w = mont.pow(mont.to(3),(p - 1) / (2 * m)), iw = mont.pow(w,p - 2);
+            roots[m] = iroots[m] = mont.to(1);
+            for (int j=1;j<m;++j){
+                roots[m+j]  = mont.mul(roots[m+j-1],w);
+                iroots[m+j] = mont.mul(iroots[m+j-1],iw);
+            }
+        }
+    }
+};
+
+// return the plan modulo p of length n from a cache, the plan is created at the first call
+// it is safe to call from several threads
+const NTTPlan& GetNTTPlan(uint32_t p,int n){
+    static map<pair<uint32_t,int>,unique_ptr<NTTPlan>> cache;
+    static mutex lock;
+    lock_guard<mutex> guard(lock);
+    unique_ptr<NTTPlan>& plan = cache[make_pair(p,n)];
+    if (!plan) plan.reset(new NTTPlan(p,n));
+    return *plan;
+}
+
+// The forward transform is decimation in frequency: it takes a[0:n) in natural order and
+// leaves the spectrum in bit-reversed order. The inverse transform is decimation in time and
+// takes the spectrum in bit-reversed order back to natural order. A convolution only multiplies
+// the spectra pointwise, so no bit-reversal permutation is needed at all
+// The values are plain residues in [0, p), only the roots are in Montgomery form
+
+inline void NTTForwardStage(uint32_t* x,int m,const NTTPlan& plan){
+    const Montgomery mont = plan.mont;
+    const uint32_t* w = plan.roots.data() + m;
+    for (int j=0;j<m;++j){
+        uint32_t u = x[j], v = x[j+m];
+        x[j]   = mont.add(u,v);
+        x[j+m] = mont.mul(mont.sub(u,v),w[j]);
+    }
+}
+
+inline void NTTInverseStage(uint32_t* x,int m,const NTTPlan& plan){
+    const Montgomery mont = plan.mont;
+    const uint32_t* w = plan.iroots.data() + m;
+    for (int j=0;j<m;++j){
+        uint32_t u = x[j], v = mont.mul(x[j+m],w[j]);
+        x[j]   = mont.add(u,v);
+        x[j+m] = mont.sub(u,v);
+    }
+}
+
+// divide a[0:n) by n after the inverse transform
+inline void NTTEpilogue(uint32_t* a,int n,const NTTPlan& plan){
+    const Montgomery& mont = plan.mont;
+    uint32_t ninv = mont.pow(mont.to((mont.p + 1) / 2),__builtin_ctz(n));
+    for (int i=0;i<n;++i) a[i] = mont.mul(a[i],ninv);
+}
+
+void NTTScalar(uint32_t* a,int n,const NTTPlan& plan,bool inv){
+    if (!inv){
+        for (int m=n>>1;m>=1;m>>=1)
+            for (int k=0;k<n;k+=2*m) NTTForwardStage(a+k,m,plan);
+    }else{
+        for (int m=1;m<n;m<<=1)
+            for (int k=0;k<n;k+=2*m) NTTInverseStage(a+k,m,plan);
+        NTTEpilogue(a,n,plan);
+    }
+}
+
+#ifdef FFT_X86_SIMD
+// 8 Montgomery multiplications: the even and the odd lanes are multiplied to 64 bits separately
+// and the reduced results are taken from the high halves, r - p wraps around if r < p
+__attribute__((target("avx2"))) inline
+__m256i MontMulAVX2(__m256i a,__m256i b,__m256i p,__m256i pinv){
+    __m256i xe = _mm256_mul_epu32(a,b);
+    __m256i xo = _mm256_mul_epu32(_mm256_srli_epi64(a,32),_mm256_srli_epi64(b,32));
+    __m256i re = _mm256_add_epi64(xe,_mm256_mul_epu32(_mm256_mul_epu32(xe,pinv),p));
+    __m256i ro = _mm256_add_epi64(xo,_mm256_mul_epu32(_mm256_mul_epu32(xo,pinv),p));
+    __m256i r = _mm256_blend_epi32(_mm256_srli_epi64(re,32),ro,0xAA);
+    return _mm256_min_epu32(r,_mm256_sub_epi32(r,p));
+}
+
+__attribute__((target("avx2"))) inline
+__m256i ModAddAVX2(__m256i a,__m256i b,__m256i p){
+    __m256i s = _mm256_add_epi32(a,b);
+    return _mm256_min_epu32(s,_mm256_sub_epi32(s,p));
+}
+
+__attribute__((target("avx2"))) inline
+__m256i ModSubAVX2(__m256i a,__m256i b,__m256i p){
+    __m256i d = _mm256_add_epi32(_mm256_sub_epi32(a,b),p);
+    return _mm256_min_epu32(d,_mm256_sub_epi32(d,p));
+}
+
+// AVX2 kernel, the stages with m < 8 fall back to the scalar butterflies
+__attribute__((target("avx2")))
+void NTTAVX2(uint32_t* a,int n,const NTTPlan& plan,bool inv){
+    const __m256i p = _mm256_set1_epi32(plan.mont.p), pinv = _mm256_set1_epi32(plan.mont.pinv);
+    if (!inv){
+        for (int m=n>>1;m>=1;m>>=1){
+            for (int k=0;k<n;k+=2*m){
+                if (m < 8){ NTTForwardStage(a+k,m,plan); continue; }
+                for (int j=0;j<m;j+=8){
+                    __m256i* x = (__m256i*)(a+k+j);
+                    __m256i* y = (__m256i*)(a+k+j+m);
+                    __m256i u = _mm256_loadu_si256(x), v = _mm256_loadu_si256(y);
+                    __m256i w = _mm256_loadu_si256((const __m256i*)(plan.roots.data()+m+j));
+                    _mm256_storeu_si256(x,ModAddAVX2(u,v,p));
+                    _mm256_storeu_si256(y,MontMulAVX2(ModSubAVX2(u,v,p),w,p,pinv));
+                }
+            }
         }
     }else{
-        for (int i=n>>1,j=i;i;--i,++j){
-            roots[j] = roots[i] = Complex<double>(cos(2*M_PI*i/n) , sin(2*M_PI*i/n));
-            roots[j].Conjugate();
+        for (int m=1;m<n;m<<=1){
+            for (int k=0;k<n;k+=2*m){
+                if (m < 8){ NTTInverseStage(a+k,m,plan); continue; }
+                for (int j=0;j<m;j+=8){
+                    __m256i* x = (__m256i*)(a+k+j);
+                    __m256i* y = (__m256i*)(a+k+j+m);
+                    __m256i w = _mm256_loadu_si256((const __m256i*)(plan.iroots.data()+m+j));
+                    __m256i u = _mm256_loadu_si256(x);
+                    __m256i v = MontMulAVX2(_mm256_loadu_si256(y),w,p,pinv);
+                    _mm256_storeu_si256(x,ModAddAVX2(u,v,p));
+                    _mm256_storeu_si256(y,ModSubAVX2(u,v,p));
+                }
+            }
         }
+        NTTEpilogue(a,n,plan);
     }
-    roots[0] = Complex<double>(1,0);
+}
+#endif
 
-    if (!inv) return FFTRecursion(a,0,n,1,roots);
+typedef void (*NTTKernel)(uint32_t*,int,const NTTPlan&,bool);
 
-    //else if (inv == true)
-    vector<Complex<double>> ans = FFTRecursion(a,0,n,1,roots);
-    for (int i=n-1;i>=0;--i){
-        ans[i] /= n;
+NTTKernel SelectNTTKernel(){
+#ifdef FFT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return NTTAVX2;
+#endif
+    return NTTScalar;
+}
+
+// in-place number theoretic transform of a[0:n) modulo plan.mont.p, n is an exponential of 2
+// and the plan has length at least n; the spectrum is in bit-reversed order (see above)
+void NTT(uint32_t* a,int n,const NTTPlan& plan,bool inv = false){
+    static const NTTKernel kernel = SelectNTTKernel();
+    kernel(a,n,plan,inv);
+}
+
+
+// v mod p in [0, p), the division is skipped when v is already in range
+template<class T>
+inline uint32_t NTTResidue(const T& v,uint32_t p){
+    if (T(0) <= v && v < T(p)) return (uint32_t)v;
+    return (uint32_t)((v % T(p) + T(p)) % T(p));
+}
+
+// Exact Convolution of integer sequences by the number theoretic transforms modulo the three
+// primes and the chinese remainder theorem, the result has length a.size() + b.size() - 1
+// R is the type of the result, e.g. ExactConvolution<long long,__int128>(a, b) when the
+// coefficients of a*b may exceed the range of long long
+// upper2exp(a.size() + b.size() - 1) must not exceed NTTMaxLength
+template<class T,class R = T>
+vector<R> ExactConvolution(const vector<T>& a,const vector<T>& b){
+    if (a.empty() || b.empty()) return vector<R>();
+    int size = a.size() + b.size() - 1, n = upper2exp(size);
+    if (n > NTTMaxLength) throw length_error("ExactConvolution: the length exceeds NTTMaxLength");
+
+    vector<uint32_t> residue[3];
+    for (int t=0;t<3;++t){
+        const uint32_t p = NTTPrimes[t];
+        const NTTPlan& plan = GetNTTPlan(p,n);
+        vector<uint32_t> x(n,0), y(n,0);
+        for (int i=a.size()-1;i>=0;--i) x[i] = NTTResidue(a[i],p);
+        for (int i=b.size()-1;i>=0;--i) y[i] = NTTResidue(b[i],p);
+        NTT(x.data(),n,plan);
+        NTT(y.data(),n,plan);
+        // mul(x, y) = x y 2^-32, so the product is converted back by one more multiplication
+        for (int i=0;i<n;++i) x[i] = plan.mont.mul(plan.mont.mul(x[i],y[i]),plan.mont.r2);
+        NTT(x.data(),n,plan,true);
+        residue[t].swap(x);
+    }
+
+    // Garner's algorithm: c = r1 + p1 x2 + p1 p2 x3 with 0 <= x2 < p2, 0 <= x3 < p3,
+    // where the reductions mod p2 and p3 are Montgomery multiplications by to(1) etc.
+    const uint64_t p1 = NTTPrimes[0], p2 = NTTPrimes[1], p3 = NTTPrimes[2];
+    const Montgomery m2(p2), m3(p3);
+    const uint32_t one2 = m2.to(1), one3 = m3.to(1), p1m3 = m3.to(p1 % p3);
+    const uint32_t inv1 = m2.pow(m2.to(p1 % p2),p2 - 2);            // p1^-1 mod p2
+    const uint32_t inv12 = m3.pow(m3.to(p1 * p2 % p3),p3 - 2);      // (p1 p2)^-1 mod p3
+    const unsigned __int128 M = (unsigned __int128)(p1 * p2) * p3;
+    vector<R> ans(size);
+    for (int i=0;i<size;++i){
+        uint32_t r1 = residue[0][i], r2 = residue[1][i], r3 = residue[2][i];
+        uint64_t x2 = m2.mul(m2.sub(r2,m2.mul(r1,one2)),inv1);
+        uint64_t x3 = m3.mul(m3.sub(r3,m3.add(m3.mul(r1,one3),m3.mul(x2,p1m3))),inv12);
+        unsigned __int128 c = r1 + p1 * x2 + (unsigned __int128)(p1 * p2) * x3;
+        // residues above M / 2 stand for negative coefficients
+        ans[i] = c > M / 2 ? (R)-(__int128)(M - c) : (R)(__int128)c;
     }
     return ans;
 }
 
 
-// Convolution, or Polynomial Multiplication
+//********************************************************
+//             Size-Adaptive Multiplication
+//********************************************************
+
+// The transforms cost O(n log n) but with a large constant, and they round the lengths up to
+// an exponential of 2, so small products are faster by the classical algorithms:
+//   schoolbook    O(la lb)
+//   Karatsuba     3 half-size products,  O(n^1.585)
+//   Toom-3        5 third-size products, O(n^1.465)
+//   FFT / NTT     O(n log n)
+// Multiply() chooses the algorithm by the length of the shorter operand, and cuts the longer
+// operand into chunks when the lengths are unbalanced, so that every product is balanced.
+// The crossovers are measured by main --tune and can be changed at runtime.
+int MultiplySchoolbookLimit = 56;
+int MultiplyKaratsubaLimit = 180;
+int MultiplyToomLimit = 200;
+
+// the floating point transforms are used while max|a| max|b| min(la, lb) (a bound of the
+// coefficients of a*b) is at most this, where the rounding errors stay below 0.01
+const double MultiplyFFTBound = 8796093022208.0; // 2^43
+
+vector<long long> Multiply(const vector<long long>& a,const vector<long long>& b);
+
+// c[offset:] += sign * x
+inline void AddTo(vector<long long>& c,const vector<long long>& x,int offset,long long sign = 1){
+    for (size_t i=0;i<x.size();++i) c[offset+i] += sign * x[i];
+}
+
+// a[l:r), which is empty if l >= a.size()
+inline vector<long long> Slice(const vector<long long>& a,size_t l,size_t r){
+    l = min(l,a.size()), r = min(r,a.size());
+    return vector<long long>(a.begin()+l,a.begin()+r);
+}
+
+vector<long long> SchoolbookMultiply(const vector<long long>& a,const vector<long long>& b){
+    vector<long long> c(a.size() + b.size() - 1,0);
+    for (size_t i=0;i<a.size();++i){
+        long long x = a[i];
+        long long* y = c.data() + i;
+        for (size_t j=0;j<b.size();++j) y[j] += x * b[j];
+    }
+    return c;
+}
+
+// a = a0 + a1 y, b = b0 + b1 y with y = x^h, then
+// a*b = z0 + ((a0 + a1)(b0 + b1) - z0 - z2) y + z2 y^2,  z0 = a0 b0,  z2 = a1 b1
+vector<long long> KaratsubaMultiply(const vector<long long>& a,const vector<long long>& b){
+    size_t h = (max(a.size(),b.size()) + 1) / 2;
+    vector<long long> a0 = Slice(a,0,h), a1 = Slice(a,h,a.size());
+    vector<long long> b0 = Slice(b,0,h), b1 = Slice(b,h,b.size());
+    vector<long long> c(a.size() + b.size() - 1,0);
+    if (a1.empty() || b1.empty()){ // one operand is not longer than h
+        if (a1.empty()) swap(a0,b0), swap(a1,b1);
+        AddTo(c,Multiply(a0,b0),0);
+        AddTo(c,Multiply(a1,b0),h);
+        return c;
+    }
+    vector<long long> z0 = Multiply(a0,b0), z2 = Multiply(a1,b1);
+    for (size_t i=0;i<a1.size();++i) a0[i] += a1[i];
+    for (size_t i=0;i<b1.size();++i) b0[i] += b1[i];
+    vector<long long> z1 = Multiply(a0,b0);
+    AddTo(c,z0,0);
+    AddTo(c,z2,2*h);
+    AddTo(c,z1,h);
+    AddTo(c,z0,h,-1);
+    AddTo(c,z2,h,-1);
+    return c;
+}
+
+// a = a0 + a1 y + a2 y^2 with y = x^k, evaluated at y = 0, 1, -1, -2, infinity, and the five
+// products are interpolated by Bodrato's sequence, whose divisions by 2 and 3 are exact
+vector<long long> Toom3Multiply(const vector<long long>& a,const vector<long long>& b){
+    size_t k = (max(a.size(),b.size()) + 2) / 3;
+    if (min(a.size(),b.size()) <= 2 * k) return KaratsubaMultiply(a,b);
+
+    // the values of the polynomial p at 0, 1, -1, -2 and infinity
+    auto evaluate = [&](const vector<long long>& p,vector<long long> v[5]){
+        vector<long long> p0 = Slice(p,0,k), p1 = Slice(p,k,2*k), p2 = Slice(p,2*k,p.size());
+        v[0] = p0;
+        v[1].assign(k,0), v[2].assign(k,0), v[3].assign(k,0);
+        for (size_t i=0;i<k;++i){
+            long long x0 = p0[i], x1 = p1[i], x2 = i < p2.size() ? p2[i] : 0;
+            v[1][i] = x0 + x1 + x2;
+            v[2][i] = x0 - x1 + x2;
+            v[3][i] = x0 - 2*x1 + 4*x2;
+        }
+        v[4] = p2;
+    };
+    vector<long long> u[5], v[5], r[5];
+    evaluate(a,u);
+    evaluate(b,v);
+    for (int t=0;t<5;++t) r[t] = Multiply(u[t],v[t]);
+
+    // r[0..4] = r(0), r(1), r(-1), r(-2), r(inf) become the coefficients of y^0..y^4
+    size_t n = r[1].size();
+    vector<long long> s1(n), s2(n), s3(n);
+    for (size_t i=0;i<n;++i){
+        long long r0 = r[0][i], r4 = i < r[4].size() ? r[4][i] : 0;
+        long long t3 = (r[3][i] - r[1][i]) / 3;
+        long long t1 = (r[1][i] - r[2][i]) / 2;
+        long long t2 = r[2][i] - r0;
+        t3 = (t2 - t3) / 2 + 2 * r4;
+        t2 = t2 + t1 - r4;
+        t1 = t1 - t3;
+        s1[i] = t1, s2[i] = t2, s3[i] = t3;
+    }
+    vector<long long> c(a.size() + b.size() - 1,0);
+    AddTo(c,r[0],0);
+    AddTo(c,Slice(s1,0,c.size()-k),k);
+    AddTo(c,Slice(s2,0,c.size()-2*k),2*k);
+    AddTo(c,Slice(s3,0,c.size()-3*k),3*k);
+    AddTo(c,r[4],4*k);
+    return c;
+}
+
+// the product of balanced operands by the floating point transforms if the coefficients are
+// small enough to be rounded correctly, otherwise by the exact transforms
+vector<long long> TransformMultiply(const vector<long long>& a,const vector<long long>& b){
+    long long ma = 0, mb = 0;
+    for (long long x: a) ma = max(ma,x < 0 ? -x : x);
+    for (long long x: b) mb = max(mb,x < 0 ? -x : x);
+    vector<long long> c;
+    if ((double)ma * mb * min(a.size(),b.size()) <= MultiplyFFTBound){
+        vector<double> x(a.begin(),a.end()), y(b.begin(),b.end());
+        vector<double> z = Convolution(x,y);
+        c.resize(z.size());
+        for (int i=z.size()-1;i>=0;--i) c[i] = llround(z[i]);
+    }else{
+        c = ExactConvolution(a,b);
+    }
+    c.resize(a.size() + b.size() - 1);
+    return c;
+}
+
+// the product of integer polynomials a*b, of length a.size() + b.size() - 1,
+// where the coefficients (and the intermediate values of Toom-3, about 50 times as large)
+// must fit in long long
+vector<long long> Multiply(const vector<long long>& a,const vector<long long>& b){
+    if (a.empty() || b.empty()) return vector<long long>();
+    if (a.size() < b.size()) return Multiply(b,a);
+    size_t la = a.size(), lb = b.size();
+    if ((int)lb <= MultiplySchoolbookLimit) return SchoolbookMultiply(a,b);
+
+    // choose the algorithm by the length lb, for a chunk of a which is not much longer than b
+    auto balanced = [&](const vector<long long>& x){
+        if ((int)lb <= MultiplyKaratsubaLimit) return KaratsubaMultiply(x,b);
+        if ((int)lb <= MultiplyToomLimit) return Toom3Multiply(x,b);
+        return TransformMultiply(x,b);
+    };
+    if (la <= 2 * lb) return balanced(a);
+
+    // unbalanced: cut a into chunks of length lb, or for the transforms into chunks which
+    // fill the length upper2exp(2 lb - 1) together with b
+    size_t chunk = (int)lb <= MultiplyToomLimit ? lb : upper2exp(2 * lb - 1) - lb + 1;
+    vector<long long> c(la + lb - 1,0);
+    for (size_t i=0;i<la;i+=chunk) AddTo(c,balanced(Slice(a,i,i+chunk)),i);
+    return c;
+}
+
+// Multiply() for other integer types, computed in long long
 template<class T>
-vector<T> Convolution(vector<T> a,vector<T> b){
-    // n is not less than the degree of polynomial a*b
-    int n = upper2exp( a.size() + b.size() );
-    fill2exp(a,n);
-    fill2exp(b,n);
-
-    vector<Complex<double>> temp1 = FFT(a);
-    vector<Complex<double>> temp2 = FFT(b);
-    for (int i=n-1;i>=0;--i){
-        temp1[i] *= temp2[i];
+vector<T> Multiply(const vector<T>& a,const vector<T>& b){
+    vector<long long> c = Multiply(vector<long long>(a.begin(),a.end()),vector<long long>(b.begin(),b.end()));
+    return vector<T>(c.begin(),c.end());
+}
+
+
+//********************************************************
+//             Long Integers Multiplication
+//********************************************************
+
+// A long integer is multiplied as a polynomial of its limbs, the groups of `width` decimal
+// digits from the lowest: base 10^4 for the floating point transforms, where the coefficients
+// of the product (at most min(la, lb) 10^8) must stay far enough from 2^53 to be rounded
+// correctly, and base 10^9 for the exact transforms, which recover coefficients up to 2^85.
+// The limbs shorten the transforms by 4 or 9 times compared with one digit per element.
+
+const int LimbPower10[10] = {1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000};
+
+// the limbs of a decimal string in base 10^width, least significant first
+vector<long long> ToLimbs(const string& s,int width){
+    int n = s.size();
+    vector<long long> limbs((n + width - 1) / width);
+    for (int i=0,end=n;end>0;++i,end-=width){
+        long long v = 0;
+        for (int k=max(0,end-width);k<end;++k) v = v * 10 + (s[k] - '0');
+        limbs[i] = v;
     }
+    return limbs;
+}
 
-    vector<T> ans(n);
-    temp1 = FFT(temp1,true); // inverse FFT
-    for (int i=n-1;i>=0;--i){
-        ans[i] = T(temp1[i]);
+// the decimal string of sum c[i] 10^(width i) for non-negative coefficients c,
+// the carries are propagated in a single pass from the lowest limb
+template<class T>
+string FromLimbs(const vector<T>& c,int width){
+    const T base = LimbPower10[width];
+    vector<uint32_t> limbs;
+    limbs.reserve(c.size() + 4);
+    T carry = 0;
+    for (size_t i=0;i<c.size();++i){
+        T v = c[i] + carry;
+        carry = v / base;
+        limbs.push_back((uint32_t)(v - carry * base));
+    }
+    for (;carry;carry/=base) limbs.push_back((uint32_t)(carry % base));
+
+    int top = limbs.size() - 1;
+    while (top > 0 && limbs[top] == 0) --top; // remove leading zeros, but keep a single "0"
+    string ans = to_string(limbs[top]);
+    int head = ans.size();
+    ans.resize(head + (size_t)top * width);
+    for (int i=top-1,pos=head;i>=0;--i,pos+=width){
+        uint32_t v = limbs[i];
+        for (int k=width-1;k>=0;--k,v/=10) ans[pos+k] = (char)('0' + v % 10);
     }
     return ans;
 }
 
+// Long Integers Multiplication by the floating point transforms in base 10^4
+// the plan must have length at least max(4, upper2exp(la + lb - 1)), where la and lb are
+// the numbers of limbs, i.e. the numbers of digits divided by 4 and rounded up
+string LongIntegersMultiplication(const string& str_a,const string& str_b,const FFTPlan& plan){
+    vector<double> a, b;
+    for (long long v: ToLimbs(str_a,4)) a.push_back((double)v);
+    for (long long v: ToLimbs(str_b,4)) b.push_back((double)v);
+    vector<double> c = Convolution(a,b,plan);
+    vector<long long> ans(c.size());
+    for (int i=c.size()-1;i>=0;--i) ans[i] = llround(c[i]);
+    return FromLimbs(ans,4);
+}
+
+// Long Integers Multiplication by the exact transforms in base 10^9, for any lengths:
+// operands longer than NTTMaxLength / 2 limbs are multiplied block by block
+string ExactLongIntegersMultiplication(const string& str_a,const string& str_b){
+    vector<long long> a = ToLimbs(str_a,9), b = ToLimbs(str_b,9);
+    const int block = NTTMaxLength / 2;
+    vector<__int128> ans(a.size() + b.size(),0);
+    for (size_t i=0;i<a.size();i+=block){
+        vector<long long> x(a.begin()+i,a.begin()+min(a.size(),i+block));
+        for (size_t j=0;j<b.size();j+=block){
+            vector<long long> y(b.begin()+j,b.begin()+min(b.size(),j+block));
+            vector<__int128> c = ExactConvolution<long long,__int128>(x,y);
+            for (size_t k=0;k+1<x.size()+y.size();++k) ans[i+j+k] += c[k];
+        }
+    }
+    return FromLimbs(ans,9);
+}
+
+// the floating point transforms are used while the shorter operand has at most this many
+// limbs of base 10^4, and the exact transforms for longer operands
+const int LongIntegersFFTLimit = 1 << 16;
+
+// Long Integers Multiplication, choosing the algorithm by the lengths: Multiply() on the limbs
+// of base 10^4, which uses the floating point transforms for long operands, or the exact transforms
+inline string LongIntegersMultiplication(const string& str_a,const string& str_b){
+    int la = (str_a.size() + 3) / 4, lb = (str_b.size() + 3) / 4;
+    if (min(la,lb) > LongIntegersFFTLimit) return ExactLongIntegersMultiplication(str_a,str_b);
+    return FromLimbs(Multiply(ToLimbs(str_a,4),ToLimbs(str_b,4)),4);
+}
+
+
+//********************************************************
+//                    Tuning
+//********************************************************
+
+typedef vector<long long> (*MultiplyKernel)(const vector<long long>&,const vector<long long>&);
 
-// Long Integers Multiplication
-string LongIntegersMultiplication(const string& str_a,const string& str_b){
-    vector<int> a(str_a.size());
-    vector<int> b(str_b.size());
-    for (int i=a.size()-1,j=0;i>=0;--i,++j) a[j] = str_a[i]-'0';
-    for (int i=b.size()-1,j=0;i>=0;--i,++j) b[j] = str_b[i]-'0';
+// the average seconds of one product of random operands of length n with digits 0..9999
+double TimeMultiply(MultiplyKernel f,int n,mt19937& rng){
+    vector<long long> a(n), b(n);
+    for (int i=0;i<n;++i) a[i] = rng() % 10000, b[i] = rng() % 10000;
+    int runs = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds;
+    do{
+        f(a,b);
+        ++runs;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }while (seconds < 0.02);
+    return seconds / runs;
+}
 
-    vector<int> ans = Convolution(a,b);
+// Measure the crossovers of Multiply() on this machine, print the timings as CSV and set
+// MultiplySchoolbookLimit, MultiplyKaratsubaLimit and MultiplyToomLimit to the results.
+// The crossovers are found in order: for every length n the limit being tuned is set to n - 1,
+// so the smaller products inside the faster algorithm use the limits found before, and the
+// crossover is the first n where the faster algorithm wins twice in a row
+void TuneMultiply(unsigned seed = 2023){
+    mt19937 rng(seed);
+    const char* names[] = {"schoolbook","karatsuba","toom3","transform"};
+    MultiplyKernel kernels[] = {SchoolbookMultiply,KaratsubaMultiply,Toom3Multiply,TransformMultiply};
+    int* limits[] = {&MultiplySchoolbookLimit,&MultiplyKaratsubaLimit,&MultiplyToomLimit};
+    const int maxlength = 1 << 14;
+    MultiplySchoolbookLimit = MultiplyKaratsubaLimit = MultiplyToomLimit = maxlength;
 
-    // prevent Access Overflow Error
-    for (int i=0;i<10;++i) ans.push_back(0);
+    cout << "length,slower,seconds,faster,seconds\n";
+    int start = 4;
+    for (int k=0;k<3;++k){
+        int crossover = maxlength, wins = 0;
+        for (int n=start;n<maxlength;n+=max(1,n/8)){
+            *limits[k] = n - 1;
+            double t0 = TimeMultiply(kernels[k],n,rng), t1 = TimeMultiply(kernels[k+1],n,rng);
+            cout << n << ',' << names[k] << ',' << t0 << ',' << names[k+1] << ',' << t1 << endl;
+            wins = t1 < t0 ? wins + 1 : 0;
+            if (wins == 2){ crossover = n; break; }
+        }
+        *limits[k] = crossover - 1;
+        start = crossover;
+    }
+    cout << "MultiplySchoolbookLimit = " << MultiplySchoolbookLimit << endl;
+    cout << "MultiplyKaratsubaLimit = " << MultiplyKaratsubaLimit << endl;
+    cout << "MultiplyToomLimit = " << MultiplyToomLimit << endl;
+}
 
-    int n = ans.size();
-    for (int i=0;i<n;++i){
-        if (ans[i]>9){
-            int temp = ans[i]%10;
-            ans[i] /= 10;
-            for (int k=1;ans[i];++k){
-                ans[i+k] += ans[i]%10;
-                ans[i] /= 10;
+
+//********************************************************
+//                     Benchmark
+//********************************************************
+
+// Time the transforms of length n = 2^4, 2^5, ... , 2^maxlog and print a CSV table of
+//   forward     : FFT(re, im, n, plan)
+//   inverse     : FFT(re, im, n, plan, true)
+//   convolution : Convolution() of two real sequences of length n/2
+// with the nanoseconds per point and the GFLOPS from the nominal 5 n log2(n) flops of a complex
+// transform (counted 3 times for a convolution, as by the textbook algorithm).
+// Then print a CSV table of the errors of Convolution() against ExactConvolution() for two
+// random sequences of length n/2 in [0, bound): the largest and the root mean square distance
+// of the coefficients before rounding, and the number of coefficients which are wrong after
+// rounding, which shows the safe bounds of the floating point transforms
+// maxlog = 26 takes several GB of memory for the plans
+void Benchmark(int maxlog,unsigned seed){
+    mt19937 rng(seed);
+    uniform_real_distribution<double> uniform(-1,1);
+    cout << "path,n,seconds,ns_per_point,gflops\n";
+    for (int lg=4;lg<=maxlog;++lg){
+        int n = 1 << lg;
+        const FFTPlan& plan = GetFFTPlan(n);
+        vector<double> re(n), im(n);
+        for (int i=0;i<n;++i) re[i] = uniform(rng), im[i] = uniform(rng);
+        // the forward and the inverse transforms alternate, so the values stay bounded
+        double seconds[3] = {0,0,0};
+        int runs = 0;
+        do{
+            auto t0 = chrono::steady_clock::now();
+            FFT(re.data(),im.data(),n,plan);
+            auto t1 = chrono::steady_clock::now();
+            FFT(re.data(),im.data(),n,plan,true);
+            auto t2 = chrono::steady_clock::now();
+            seconds[0] += chrono::duration<double>(t1 - t0).count();
+            seconds[1] += chrono::duration<double>(t2 - t1).count();
+            ++runs;
+        }while (seconds[0] + seconds[1] < 0.1);
+        vector<double> a(re.begin(),re.begin() + n/2), b(im.begin(),im.begin() + n/2);
+        int convruns = 0;
+        auto start = chrono::steady_clock::now();
+        do{
+            Convolution(a,b);
+            ++convruns;
+            seconds[2] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }while (seconds[2] < 0.1);
+
+        const char* paths[] = {"forward","inverse","convolution"};
+        for (int k=0;k<3;++k){
+            double t = seconds[k] / (k < 2 ? runs : convruns);
+            double flops = 5.0 * n * lg * (k < 2 ? 1 : 3);
+            cout << paths[k] << ',' << n << ',' << t << ',' << t / n * 1e9 << ',' << flops / t * 1e-9 << endl;
+        }
+    }
+
+    cout << "\nn,bound,max_error,rms_error,wrong\n";
+    for (int lg=10;lg<=min(maxlog,22);lg+=4){
+        int n = 1 << lg;
+        for (int bits=4;bits<=24;bits+=4){
+            vector<long long> a(n/2), b(n/2);
+            for (int i=0;i<n/2;++i) a[i] = rng() & ((1 << bits) - 1), b[i] = rng() & ((1 << bits) - 1);
+            vector<double> x(a.begin(),a.end()), y(b.begin(),b.end());
+            vector<double> c = Convolution(x,y);
+            vector<__int128> exact = ExactConvolution<long long,__int128>(a,b);
+            long double maxerr = 0, sum = 0;
+            long long wrong = 0;
+            for (size_t i=0;i<exact.size();++i){
+                long double e = fabsl((long double)c[i] - (long double)exact[i]);
+                maxerr = max(maxerr,e), sum += e * e;
+                wrong += (__int128)llround(c[i]) != exact[i];
             }
-            ans[i] = temp;
+            cout << n << ',' << (1LL << bits) << ',' << (double)maxerr << ','
+                 << (double)sqrtl(sum / exact.size()) << ',' << wrong << endl;
         }
     }
-    
-    string ans2;
-    int j = n-1;
-    while (ans[j] == 0) --j;  // remove leading zeros
-    for (;j>=0;--j) ans2 += (char)(ans[j]+'0');
-    return ans2;
 }
 
 
 // Test
-int main(){
+// Run with the argument --tune to measure the crossovers of Multiply() instead
+// Run with the arguments --bench [maxlog] [seed] to run the benchmark instead
+int main(int argc,char** argv){
+    if (argc > 1 && string(argv[1]) == "--tune"){
+        TuneMultiply();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench"){
+        int maxlog = argc > 2 ? atoi(argv[2]) : 22;
+        unsigned seed = argc > 3 ? atoi(argv[3]) : 2023;
+        Benchmark(maxlog,seed);
+        return 0;
+    }
     /*
     vector<int> a({1,2,3,5,-2,4,3});
     vector<Complex<double>> b = FFT(a);
@@ -1,223 +1,1404 @@
 // Max Flow by Dinic
 //#pragma GCC optimize(2)
 #include<iostream>
+#include<cstdio>
 #include<vector>
-#include<list>
-#include<queue>
+#include<limits>
+#include<cmath>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<algorithm>
+#include<chrono>
+#include<string>
+#include<random>
+#if defined(__unix__) || defined(__APPLE__)
+#define MAXFLOW_POSIX
+#include<sys/resource.h>
+#include<sys/wait.h>
+#include<unistd.h>
+#endif
 
 using namespace std;
 
+// Residual graph stored in compressed sparse row (CSR) form
+// It is built once from the network and then updated in place by every augmentation,
+// so no phase allocates anything
+// Every vertex owns a contiguous block of arcs; the blocks are laid out in order by the build,
+// but a block may later be moved to the end of the arrays to make room for new arcs
 template<class T>
-struct edge{
-    // variable id records both whether it's a reverse edge and its index in the adjaency list
-    // if   id >= 0 , it is a forward edge and graph[i][id] is this edge
-    // if   id <  0 , it is a reverse edge and graph[next][-id-1] is this edge  
-    int id;  
-
-    // the start of the edge is unneccessary to record, only the end is needed
-    int next;
-    T val;
+struct ResidualGraph{
+    int n;
+    // the arcs leaving vertex i are stored in [head[i], end[i])
+    vector<int> head, end;
+
+    // to[e] is the end of arc e and rev[e] is the index of its paired reverse arc
+    // cap[e] is the residual capacity of arc e, pushing d units along e means
+    //      cap[e] -= d,  cap[rev[e]] += d
+    vector<int> to, rev;
+    vector<T> cap;
+
+    // level[i] is the level of vertex i in the current phase (source has level 1)
+    // level[i] == 0 if i is unreachable or has been pruned as a dead end
+    vector<int> level;
+    vector<int> queue; // BFS buffer, reused by every phase
+    // only queue[0, visited) may have a nonzero level or a current arc in use, so the next
+    // phase resets just these vertices; visited = -1 if unknown and everything is reset
+    int visited = 0;
+
+    // cur[i] is the current arc of vertex i: arcs before it are known to be useless in this phase
+    vector<int> cur;
+
+    // explicit DFS stack of the blocking flow, stack[d] is the vertex at depth d,
+    // limit[d] is the flow offered to it and used[d] is the flow it has already pushed
+    vector<int> stack;
+    vector<T> limit, used;
 };
 
 
-// Construct a residual graph given the network graph (graph, capacity, flow)
+// Allocate the per-vertex working buffers of the residual graph
+template<class T>
+void AllocateBuffers(ResidualGraph<T>& g){
+    g.level.assign(g.n,0);
+    g.visited = 0;
+    g.queue.resize(g.n);
+    g.cur.resize(g.n);
+    g.stack.resize(g.n);
+    g.limit.resize(g.n);
+    g.used.resize(g.n);
+}
+
+
+// Construct the residual graph of the network (graph, capacity) with zero flow
+// Every edge i -> graph[i][j] gives a forward arc with capacity[i][j] and a reverse arc with 0
 template<class T>
-inline vector<list<struct edge<T>>> ResidualGraph(const vector<vector<int>>& graph,
-                                        const vector<vector<T>>& capacity,
-                                        const vector<vector<T>>& flow){
+void BuildResidualGraph(ResidualGraph<T>& g, const vector<vector<int>>& graph,
+                                        const vector<vector<T>>& capacity){
     int n = graph.size();
-    vector<list<struct edge<T>>> residualgraph(n);
+    g.n = n;
+    g.head.assign(n+1,0);
     for (int i=0;i<n;++i){
-        int m = graph[i].size();
-        for (int j=0;j<m;++j){
-            if (graph[i][j] == i) continue;
-            if (flow[i][j] > 0){
-                // reverse edge
-                residualgraph[graph[i][j]].push_back((struct edge<T>){-j-1,i,flow[i][j]});
-            }
-            if (flow[i][j] != capacity[i][j]){
-                residualgraph[i].push_back(
-                        (struct edge<T>){j,graph[i][j],capacity[i][j] - flow[i][j]});
-            }
+        for (int v: graph[i]){
+            if (v == i) continue;
+            ++g.head[i+1];
+            ++g.head[v+1];
         }
     }
-    return residualgraph;
+    for (int i=0;i<n;++i) g.head[i+1] += g.head[i];
+    g.end.assign(g.head.begin()+1,g.head.end());
+
+    int m = g.head[n];
+    g.to.resize(m);
+    g.rev.resize(m);
+    g.cap.assign(m,T(0));
+    vector<int> pos(g.head.begin(),g.head.end()-1);
+    for (int i=0;i<n;++i){
+        int deg = graph[i].size();
+        for (int j=0;j<deg;++j){
+            int v = graph[i][j];
+            if (v == i) continue;
+            int e = pos[i]++, r = pos[v]++;
+            g.to[e] = v, g.rev[e] = r, g.cap[e] = capacity[i][j];
+            g.to[r] = i, g.rev[r] = e;
+        }
+    }
+    g.head.pop_back();
+    AllocateBuffers(g);
 }
 
 
-// Modify the residual graph to a level graph by erasing some of the edges
+// Construct the residual graph of the network given by an edge list with zero flow
+// Edge k goes from eu[k] to ev[k] with capacity ec[k], and its forward arc is written to arc[k]
+// (arc[k] = -1 for a self-cycle)
 template<class T>
-void LevelGraph(vector<list<struct edge<T>>>& resgraph, int source,int sink){
-    typedef typename list<struct edge<T>>::iterator itertype;
-    int n = resgraph.size();
-    deque<int> q;
-    vector<int> level(n,n+2);
-    q.push_back(source);
-    level[source] = 1;
-    while (!q.empty()){
-        int i = q.front();
-        q.pop_front();
-        if (i == sink){
+void BuildResidualGraph(ResidualGraph<T>& g, int n, const vector<int>& eu, const vector<int>& ev,
+                                        const vector<T>& ec, vector<int>& arc){
+    int m = eu.size();
+    g.n = n;
+    g.head.assign(n+1,0);
+    for (int k=0;k<m;++k){
+        if (eu[k] == ev[k]) continue;
+        ++g.head[eu[k]+1];
+        ++g.head[ev[k]+1];
+    }
+    for (int i=0;i<n;++i) g.head[i+1] += g.head[i];
+    g.end.assign(g.head.begin()+1,g.head.end());
+
+    g.to.resize(g.head[n]);
+    g.rev.resize(g.head[n]);
+    g.cap.assign(g.head[n],T(0));
+    arc.resize(m);
+    vector<int> pos(g.head.begin(),g.head.end()-1);
+    for (int k=0;k<m;++k){
+        int u = eu[k], v = ev[k];
+        if (u == v){
+            arc[k] = -1;
+            continue;
+        }
+        int e = pos[u]++, r = pos[v]++;
+        g.to[e] = v, g.rev[e] = r, g.cap[e] = ec[k];
+        g.to[r] = u, g.rev[r] = e;
+        arc[k] = e;
+    }
+    g.head.pop_back();
+    AllocateBuffers(g);
+}
+
+
+//********************************************************
+//                  Statistics Policies
+//********************************************************
+
+// The solvers below take a statistics policy ``Stats`` as a template parameter and call its hooks
+// NoStats is the default policy, its hooks are empty so that they are optimized away
+struct NoStats{
+    static const bool enabled = false;
+    void begin_phase(){}
+    void end_phase(){}
+    void bfs_scan(long long){}     // arcs scanned by the BFS
+    void dfs_scan(long long){}     // arcs scanned by the DFS
+    void path(){}                  // an augmenting path reaches the sink
+    void prune(){}                 // a dead end is pruned from the level graph
+};
+NoStats nostats;
+
+
+// FlowStats records the counters of every phase and the wall time spent in it
+// A phase is one BFS together with the blocking flow after it, the last phase is the BFS
+// that fails to reach the sink
+struct FlowStats{
+    static const bool enabled = true;
+    struct Phase{
+        long long paths = 0, bfs_scans = 0, dfs_scans = 0, prunings = 0;
+        double seconds = 0;
+    };
+    vector<Phase> phases;
+    chrono::steady_clock::time_point start;
+
+    void begin_phase(){
+        phases.push_back(Phase());
+        start = chrono::steady_clock::now();
+    }
+    void end_phase(){
+        phases.back().seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    void bfs_scan(long long k){ phases.back().bfs_scans += k;}
+    void dfs_scan(long long k){ phases.back().dfs_scans += k;}
+    void path(){ ++phases.back().paths;}
+    void prune(){ ++phases.back().prunings;}
+
+    // dump the totals and the per-phase records as a JSON object
+    void print_json(ostream& out) const{
+        Phase total;
+        for (const Phase& p: phases){
+            total.paths += p.paths, total.bfs_scans += p.bfs_scans, total.dfs_scans += p.dfs_scans;
+            total.prunings += p.prunings, total.seconds += p.seconds;
+        }
+        auto print = [&](const Phase& p){
+            out << "{\"paths\":" << p.paths << ",\"bfs_scans\":" << p.bfs_scans
+                << ",\"dfs_scans\":" << p.dfs_scans << ",\"prunings\":" << p.prunings
+                << ",\"seconds\":" << p.seconds << '}';
+        };
+        out << "{\"phase_count\":" << phases.size() << ",\"total\":";
+        print(total);
+        out << ",\"phases\":[";
+        for (size_t k=0;k<phases.size();++k){
+            if (k) out << ',';
+            print(phases[k]);
+        }
+        out << "]}";
+    }
+};
+
+
+// Compute the levels of the residual graph by BFS from the source
+// An arc e: i -> j belongs to the level graph iff cap[e] > 0 and level[j] == level[i] + 1
+// The search stops once the level of the sink is complete, so level[i] is the distance
+// from the source plus one if it does not exceed that of the sink, otherwise 0
+// return whether the sink is reachable
+template<class T, class Stats = NoStats>
+bool LevelGraph(ResidualGraph<T>& g, int source,int sink, Stats& stats = nostats){
+    if (g.visited < 0){
+        for (int i=0;i<g.n;++i) g.level[i] = 0;
+    }else{
+        for (int k=0;k<g.visited;++k) g.level[g.queue[k]] = 0;
+    }
+    int qhead = 0, qtail = 0;
+    g.queue[qtail++] = source;
+    g.level[source] = 1;
+    while (qhead < qtail){
+        int i = g.queue[qhead++];
+        if (g.level[sink] && g.level[i] >= g.level[sink]){
             break;
         }
-        for (struct edge<T>& neighbor: resgraph[i]){
-            if (level[neighbor.next] > n){
-                level[neighbor.next] = level[i] + 1;
-                q.push_back(neighbor.next);
+        stats.bfs_scan(g.end[i] - g.head[i]);
+        for (int e=g.head[i];e<g.end[i];++e){
+            int v = g.to[e];
+            if (g.cap[e] != T(0) && g.level[v] == 0){
+                g.level[v] = g.level[i] + 1;
+                g.queue[qtail++] = v;
             }
         }
     }
+    g.visited = qtail;
+    return g.level[sink] != 0;
+}
 
-    for (int i=0;i<n;++i){
-        for (itertype iter=resgraph[i].begin(); iter!=resgraph[i].end();){
-            if (level[iter->next] != level[i] + 1){
-                iter = resgraph[i].erase(iter);
+
+// A minimal fork-join thread pool
+// run(f) calls f(tid, size()) on every thread (the calling thread is tid 0) and waits for all of them
+class ThreadPool{
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable start, done;
+    function<void(int,int)> task;
+    int generation = 0, pending = 0;
+    bool stop = false;
+
+public:
+    ThreadPool(int n){
+        for (int tid=1;tid<n;++tid){
+            workers.emplace_back([this,tid](){
+                int seen = 0;
+                while (1){
+                    unique_lock<mutex> lock(mtx);
+                    start.wait(lock,[&](){ return stop || generation != seen;});
+                    if (stop) return;
+                    seen = generation;
+                    lock.unlock();
+                    task(tid,size());
+                    lock.lock();
+                    if (--pending == 0) done.notify_one();
+                }
+            });
+        }
+    }
+    ~ThreadPool(){
+        {
+            lock_guard<mutex> lock(mtx);
+            stop = true;
+        }
+        start.notify_all();
+        for (thread& t: workers) t.join();
+    }
+    int size() const{ return workers.size() + 1;}
+    void run(const function<void(int,int)>& f){
+        {
+            lock_guard<mutex> lock(mtx);
+            task = f;
+            pending = workers.size();
+            ++generation;
+        }
+        start.notify_all();
+        f(0,size());
+        unique_lock<mutex> lock(mtx);
+        done.wait(lock,[&](){ return pending == 0;});
+    }
+};
+
+
+// Buffers of the parallel BFS, reused by every phase
+struct ParallelBFSBuffer{
+    vector<int> frontier, next;
+    vector<vector<int>> local;   // local[tid] records the vertices discovered by thread tid
+    vector<long long> degree;    // degree[tid] records the total out-degree of local[tid]
+    vector<long long> scans;     // scans[tid] records the arcs scanned by thread tid (with stats only)
+};
+
+
+// Same as LevelGraph, but every level of the BFS is expanded by all the threads of the pool
+// Small frontiers are expanded top-down, where the unvisited ends of the arcs are claimed by
+// an atomic compare-and-swap on level[]; once the frontier holds a large part of the unexplored
+// arcs, it switches to bottom-up expansion where every unvisited vertex looks for a parent in
+// the frontier (direction-optimizing BFS). The level[] array is exactly that of LevelGraph
+template<class T, class Stats = NoStats>
+bool ParallelLevelGraph(ResidualGraph<T>& g, ThreadPool& pool, ParallelBFSBuffer& buf,
+                        int source,int sink, Stats& stats = nostats){
+    const int alpha = 14, beta = 24; // switching thresholds of direction-optimizing BFS
+    int n = g.n, p = pool.size();
+    int* level = g.level.data();
+    buf.local.resize(p);
+    buf.degree.resize(p);
+    buf.scans.assign(p,0);
+    g.visited = -1; // the levels are not recorded in g.queue
+    pool.run([&](int tid,int nt){
+        for (int i=(long long)n*tid/nt, end=(long long)n*(tid+1)/nt;i<end;++i) level[i] = 0;
+    });
+    level[source] = 1;
+    buf.frontier.assign(1,source);
+    long long frontier_arcs = g.end[source] - g.head[source];
+    long long unexplored_arcs = (long long)g.to.size() - frontier_arcs;
+    bool bottomup = false;
+
+    for (int L=1; !buf.frontier.empty() && level[sink] == 0; ++L){
+        if (!bottomup && frontier_arcs * alpha > unexplored_arcs) bottomup = true;
+        else if (bottomup && (long long)buf.frontier.size() * beta < n) bottomup = false;
+
+        pool.run([&](int tid,int nt){
+            vector<int>& local = buf.local[tid];
+            long long deg = 0;
+            local.clear();
+            if (!bottomup){
+                int sz = buf.frontier.size();
+                for (int k=(long long)sz*tid/nt, end=(long long)sz*(tid+1)/nt;k<end;++k){
+                    int i = buf.frontier[k];
+                    if (Stats::enabled) buf.scans[tid] += g.end[i] - g.head[i];
+                    for (int e=g.head[i];e<g.end[i];++e){
+                        int v = g.to[e];
+                        if (g.cap[e] != T(0) && __atomic_load_n(level+v,__ATOMIC_RELAXED) == 0
+                                && __sync_bool_compare_and_swap(level+v,0,L+1)){
+                            local.push_back(v);
+                            deg += g.end[v] - g.head[v];
+                        }
+                    }
+                }
             }else{
-                ++iter;
+                for (int v=(long long)n*tid/nt, end=(long long)n*(tid+1)/nt;v<end;++v){
+                    if (level[v] != 0) continue;
+                    for (int e=g.head[v];e<g.end[v];++e){
+                        if (Stats::enabled) ++buf.scans[tid];
+                        // the arc rev[e] goes from to[e] to v
+                        if (__atomic_load_n(level+g.to[e],__ATOMIC_RELAXED) == L && g.cap[g.rev[e]] != T(0)){
+                            __atomic_store_n(level+v,L+1,__ATOMIC_RELAXED);
+                            local.push_back(v);
+                            deg += g.end[v] - g.head[v];
+                            break;
+                        }
+                    }
+                }
+            }
+            buf.degree[tid] = deg;
+        });
+
+        // concatenate the local frontiers
+        int total = 0;
+        frontier_arcs = 0;
+        for (int tid=0;tid<p;++tid) total += buf.local[tid].size(), frontier_arcs += buf.degree[tid];
+        unexplored_arcs -= frontier_arcs;
+        buf.next.resize(total);
+        pool.run([&](int tid,int /*nt*/){
+            int offset = 0;
+            for (int k=0;k<tid;++k) offset += buf.local[k].size();
+            for (int v: buf.local[tid]) buf.next[offset++] = v;
+        });
+        swap(buf.frontier,buf.next);
+    }
+    for (int tid=0;tid<p;++tid) stats.bfs_scan(buf.scans[tid]);
+    return level[sink] != 0;
+}
+
+
+// Find a blocking flow (of value at most ``maxflow``) on the level graph and augment it,
+// return the value of the flow
+// Every vertex keeps a current arc so that each arc is scanned at most once per phase,
+// and the flow is pushed down several branches before returning the unused part upward.
+// The DFS runs on an explicit stack, so the depth of the level graph is only bounded by memory
+// It is guaranteed that there is no cycle on the (directed) levelgraph
+template<class T, class Stats = NoStats>
+T BlockingFlow(ResidualGraph<T>& g, int source,int sink, T maxflow = numeric_limits<T>::max(),
+               Stats& stats = nostats){
+    // only the vertices reached by the last BFS can be visited
+    if (g.visited < 0){
+        for (int i=0;i<g.n;++i) g.cur[i] = g.head[i];
+    }else{
+        for (int k=0;k<g.visited;++k) g.cur[g.queue[k]] = g.head[g.queue[k]];
+    }
+    int d = 0;
+    g.stack[0] = source;
+    g.limit[0] = maxflow;
+    g.used[0] = T(0);
+    T pushed(0);
+    while (1){
+        int v = g.stack[d];
+        if (v == sink){
+            // reach the sink (target), all the offered flow can be pushed
+            stats.path();
+            pushed = g.limit[d];
+        }else{
+            int& e = g.cur[v];
+            int end = g.end[v], first = e;
+            while (e < end && (g.cap[e] == T(0) || g.level[g.to[e]] != g.level[v] + 1)) ++e;
+            stats.dfs_scan(e - first + (e < end));
+            if (e < end && g.used[d] != g.limit[d]){
+                // go dfs along the current arc
+                T rest = g.limit[d] - g.used[d];
+                g.stack[d+1] = g.to[e];
+                g.limit[d+1] = g.cap[e] < rest ? g.cap[e] : rest;
+                g.used[d+1] = T(0);
+                ++d;
+                continue;
+            }
+            if (e == end){
+                g.level[v] = 0; // dead end, prune it from the level graph
+                stats.prune();
             }
+            pushed = g.used[d];
+        }
+
+        // return the flow pushed from stack[d] to its parent
+        if (d == 0) return pushed;
+        --d;
+        int e = g.cur[g.stack[d]];
+        if (pushed != T(0)){
+            // Augment
+            g.cap[e] -= pushed;
+            g.cap[g.rev[e]] += pushed;
+            g.used[d] += pushed;
         }
     }
+}
+
+
+// Augment the current flow of the residual graph by Dinic phases until no augmenting path
+// from source to sink is left, or the flow value has been increased by ``maxflow``
+// return the increment of the flow value
+template<class T, class Stats = NoStats>
+T Augment(ResidualGraph<T>& g, int source,int sink, T maxflow = numeric_limits<T>::max(),
+          Stats& stats = nostats){
+    T ans(0);
+    while (ans != maxflow){ // Phase
+        stats.begin_phase();
+        bool reachable = LevelGraph(g,source,sink,stats);
+        if (reachable) ans += BlockingFlow(g,source,sink,maxflow - ans,stats);
+        stats.end_phase();
+        if (!reachable) break;
+    }
+    return ans;
+}
 
-    return ;
+
+// @brief Perform Dinic algorithm on the network, self-cycles and duplicated edges are permitted
+// @param graph: Adjacency List, where graph[i] records the indices that can reach from i
+// @param capacity: Same shape as graph, capacity[i][j] records the capacity of edge[i][j]
+// @param source: Source index
+// @param sink: Sink index
+// @param threads: Number of threads used by the BFS of each phase,
+//                 small graphs (less than 65536 arcs) always use the serial BFS
+// @param stats: Statistics policy recording the counters of each phase, e.g. FlowStats
+// @return the value of max flow
+template<class T, class Stats = NoStats>
+T Dinic(vector<vector<int>>& graph,
+            vector<vector<T>>& capacity, int source, int sink, int threads = 1,
+            Stats& stats = nostats){
+    if (source == sink) return T(0);
+    // Initialization
+    ResidualGraph<T> g;
+    BuildResidualGraph(g,graph,capacity);
+    return Dinic(g,source,sink,threads,stats);
 }
 
 
-// Search a feasible path on the levelgraph
-// It is guaranteed that there is no cycle on the (directed) levelgraph
+// Same as above, but runs on a residual graph that has already been built,
+// e.g. by ReadNetwork, and augments its flow in place
+template<class T, class Stats = NoStats>
+T Dinic(ResidualGraph<T>& g, int source, int sink, int threads = 1, Stats& stats = nostats){
+    if (source == sink) return T(0);
+    T ans(0);
+    if (threads > 1 && g.to.size() >= (1<<16)){
+        ThreadPool pool(threads);
+        ParallelBFSBuffer buf;
+        while (1){ // Phase
+            stats.begin_phase();
+            bool reachable = ParallelLevelGraph(g,pool,buf,source,sink,stats);
+            if (reachable) ans += BlockingFlow(g,source,sink,numeric_limits<T>::max(),stats);
+            stats.end_phase();
+            if (!reachable) break;
+        }
+        return ans;
+    }
+    return ans + Augment(g,source,sink,numeric_limits<T>::max(),stats);
+}
+
+
+
+//********************************************************
+//              Incremental Max Flow Solver
+//********************************************************
+
+// A max flow solver that owns the residual graph and the current flow,
+// so that the flow is re-solved warm after changing the network
+// Usage:
+//      MaxFlowSolver<long long> solver(n, source, sink);
+//      int e = solver.add_edge(u, v, c);
+//      solver.solve();             // the max flow
+//      solver.set_capacity(e, c2);
+//      solver.solve();             // resumes from the previous flow
 template<class T>
-bool DFS(vector<list<struct edge<T>>>& levelgraph,
-                    vector<typename list<struct edge<T>>::iterator>& path,
-                    int i,int sink){
-    typedef typename list<struct edge<T>>::iterator itertype;
-    for (itertype iter=levelgraph[i].begin(); iter!=levelgraph[i].end();){
-        if (iter->val == T(0)){  // zero capacity left, erase it!
-            iter = levelgraph[i].erase(iter);
-        }else if (iter->next == sink){  // reach the sink (target)
-            path.push_back(iter);
-            return true;          
-        }else if (levelgraph[iter->next].empty()){  // dead end, erase it!
-            iter = levelgraph[i].erase(iter);
-        }else{ // go dfs
-            path.push_back(iter);
-            if (DFS(levelgraph,path,iter->next,sink)) return true;
-            path.pop_back();
-            ++iter;
-        }
-    }
-    return false;
-}
-
-
-// Search a feasible path in the levelgraph from source to sink
-// and overwrite the path in the vector ``path``
+class MaxFlowSolver{
+    int n, source, sink;
+    vector<int> eu, ev, arc;  // edge k goes from eu[k] to ev[k], its forward arc is arc[k]
+    vector<T> ecap;           // capacity of edge k
+    int built = 0;            // edges [0, built) are in the residual graph
+    ResidualGraph<T> g;
+    vector<int> room;         // the arc block of vertex i may grow up to room[i]
+    vector<int> owner;        // owner[e] is the edge whose forward arc is e, -1 for a reverse arc
+    T value;                  // value of the current flow
+
+    // Rebuild the residual graph with the newly added edges, keeping the flow of the old ones
+    // The blocks are laid out compactly again, with no room to grow
+    void rebuild(){
+        vector<T> flow(built);
+        for (int k=0;k<built;++k) flow[k] = arc[k] >= 0 ? g.cap[g.rev[arc[k]]] : T(0);
+        BuildResidualGraph(g,n,eu,ev,ecap,arc);
+        for (int k=0;k<built;++k){
+            if (arc[k] < 0) continue;
+            g.cap[arc[k]] -= flow[k];
+            g.cap[g.rev[arc[k]]] += flow[k];
+        }
+        built = eu.size();
+        room = g.end;
+        owner.assign(g.to.size(),-1);
+        for (int k=0;k<built;++k) if (arc[k] >= 0) owner[arc[k]] = k;
+    }
+
+    // Move the full arc block of vertex u to the end of the arrays, with twice the room
+    // The old block is left unused
+    void grow(int u){
+        int b = g.head[u], d = g.end[u] - b, nb = g.to.size(), size = 2*d + 2;
+        g.to.resize(nb + size);
+        g.rev.resize(nb + size);
+        g.cap.resize(nb + size,T(0));
+        owner.resize(nb + size,-1);
+        for (int k=0;k<d;++k){
+            int x = b + k, y = nb + k;
+            g.to[y] = g.to[x], g.rev[y] = g.rev[x], g.cap[y] = g.cap[x];
+            g.rev[g.rev[x]] = y;
+            owner[y] = owner[x];
+            if (owner[y] >= 0) arc[owner[y]] = y;
+        }
+        g.head[u] = nb, g.end[u] = nb + d, room[u] = nb + size;
+    }
+
+    // Append the arcs of edge k (with zero flow) to the blocks of its ends
+    void insert(int k){
+        int u = eu[k], v = ev[k];
+        if (u == v){
+            arc[k] = -1;
+            return;
+        }
+        if (g.end[u] == room[u]) grow(u);
+        if (g.end[v] == room[v]) grow(v);
+        int e = g.end[u]++, r = g.end[v]++;
+        g.to[e] = v, g.rev[e] = r, g.cap[e] = ecap[k];
+        g.to[r] = u, g.rev[r] = e, g.cap[r] = T(0);
+        owner[e] = k, owner[r] = -1;
+        arc[k] = e;
+    }
+
+public:
+    MaxFlowSolver(int _n,int _source,int _sink):n(_n),source(_source),sink(_sink),value(0){
+        rebuild();
+    }
+
+    // add an edge u -> v with capacity c and return its id
+    int add_edge(int u,int v,T c){
+        eu.push_back(u);
+        ev.push_back(v);
+        ecap.push_back(c);
+        return eu.size() - 1;
+    }
+
+    T capacity(int id) const{ return ecap[id];}
+
+    // flow on edge id, as of the last call to solve()
+    T flow(int id) const{ return id < built && arc[id] >= 0 ? g.cap[g.rev[arc[id]]] : T(0);}
+
+    // Change the capacity of edge id to c
+    // If c is less than the flow on the edge, the excess is first rerouted around the edge
+    // in the residual graph, and the rest is cancelled back to the source and the sink,
+    // so only the flow near the edge is changed
+    void set_capacity(int id,T c){
+        ecap[id] = c;
+        if (id >= built || arc[id] < 0) return;
+        int e = arc[id], r = g.rev[e];
+        T f = g.cap[r];
+        if (c >= f){
+            g.cap[e] = c - f;
+            return;
+        }
+        // now u = eu[id] has an excess and v = ev[id] has a deficit of f - c
+        int u = eu[id], v = ev[id];
+        T delta = f - c;
+        g.cap[e] = T(0);
+        g.cap[r] = c;
+        delta -= Augment(g,u,v,delta);
+        if (delta == T(0)) return;
+        if (u != source) Augment(g,u,source,delta);
+        if (v != sink) Augment(g,sink,v,delta);
+        value -= delta;
+    }
+
+    // @return the value of max flow of the current network
+    T solve(){
+        if (source == sink) return T(0);
+        int pending = eu.size() - built;
+        if ((long long)pending * 4 > (long long)built + n){
+            // a large batch, rebuilding costs O(n + m) but restores the compact layout
+            rebuild();
+        }else if (pending > 0){
+            // a small batch, each new edge is appended to the blocks of its ends
+            arc.resize(eu.size());
+            for (int k=built;k<(int)eu.size();++k) insert(k);
+            built = eu.size();
+        }
+        value += Augment(g,source,sink);
+        return value;
+    }
+};
+
+//********************************************************
+//          Highest-Label Push-Relabel (HLPP)
+//********************************************************
+
+// Recompute exact heights (distance to the sink in the residual graph) by a reverse BFS,
+// vertices that cannot reach the sink get height n and are no longer active
+// Then rebuild the buckets of active vertices and the counts of vertices at each height
 template<class T>
-void DFSHandler(vector<list<struct edge<T>>>& levelgraph,
-                vector<typename list<struct edge<T>>::iterator>& path,
-                int source,int sink){
-    path.clear();
-    DFS(levelgraph,path,source,sink);
+int GlobalRelabel(ResidualGraph<T>& g, int source, int sink, const vector<T>& excess,
+                  vector<int>& height, vector<int>& cnt, vector<vector<int>>& bucket){
+    int n = g.n;
+    for (int i=0;i<n;++i) height[i] = n, g.cur[i] = g.head[i];
+    for (int h=0;h<n;++h) cnt[h] = 0, bucket[h].clear();
+    g.visited = -1; // g.queue is overwritten below
+    int qhead = 0, qtail = 0;
+    g.queue[qtail++] = sink;
+    height[sink] = 0;
+    while (qhead < qtail){
+        int u = g.queue[qhead++];
+        ++cnt[height[u]];
+        for (int e=g.head[u];e<g.end[u];++e){
+            int w = g.to[e];
+            // w -> u is the arc rev[e], it is admissible to w iff it has residual capacity
+            if (w != source && height[w] == n && g.cap[g.rev[e]] != T(0)){
+                height[w] = height[u] + 1;
+                g.queue[qtail++] = w;
+            }
+        }
+    }
+
+    int highest = -1;
+    for (int i=0;i<n;++i){
+        if (i != sink && height[i] < n && excess[i] != T(0)){
+            bucket[height[i]].push_back(i);
+            if (height[i] > highest) highest = height[i];
+        }
+    }
+    return highest;
 }
 
 
-// @brief Perform Dinic algorithm on the network, self-cycles and duplicated edges are permitted
+// @brief Perform highest-label push-relabel algorithm with the gap and global relabeling heuristics
 // @param graph: Adjacency List, where graph[i] records the indices that can reach from i
 // @param capacity: Same shape as graph, capacity[i][j] records the capacity of edge[i][j]
 // @param source: Source index
 // @param sink: Sink index
-// @return the value of max flow
+// @return the value of max flow, which is the same as Dinic(graph, capacity, source, sink)
+// Only the first phase (computing a maximum preflow) is performed, so the excess left on
+// the vertices that cannot reach the sink is not returned to the source
 template<class T>
-T Dinic(vector<vector<int>>& graph,
+T PushRelabel(vector<vector<int>>& graph,
             vector<vector<T>>& capacity, int source, int sink){
     if (source == sink) return T(0);
     // Initialization
+    ResidualGraph<T> g;
+    BuildResidualGraph(g,graph,capacity);
+    int n = g.n;
+    vector<T> excess(n,T(0));
+    vector<int> height(n), cnt(n+1);
+    vector<vector<int>> bucket(n); // bucket[h] records the active vertices of height h
+
+    // saturate all the arcs leaving the source
+    for (int e=g.head[source];e<g.end[source];++e){
+        T c = g.cap[e];
+        if (c == T(0)) continue;
+        g.cap[e] -= c;
+        g.cap[g.rev[e]] += c;
+        excess[g.to[e]] += c;
+    }
+    int highest = GlobalRelabel(g,source,sink,excess,height,cnt,bucket);
+    int relabels = 0;
+
+    while (1){
+        while (highest >= 0 && bucket[highest].empty()) --highest;
+        if (highest < 0) break;
+        int v = bucket[highest].back();
+        bucket[highest].pop_back();
+        if (height[v] != highest || excess[v] == T(0)) continue; // outdated entry
+
+        // Discharge v
+        while (excess[v] != T(0)){
+            int& e = g.cur[v];
+            if (e == g.end[v]){
+                // Relabel
+                ++relabels;
+                int h = height[v], newh = n;
+                for (int a=g.head[v];a<g.end[v];++a){
+                    if (g.cap[a] != T(0) && height[g.to[a]] + 1 < newh) newh = height[g.to[a]] + 1;
+                }
+                e = g.head[v];
+                if (--cnt[h] == 0){
+                    // Gap: no vertex of height h is left, so all the vertices above can not reach the sink
+                    for (int i=0;i<n;++i){
+                        if (height[i] > h && height[i] < n) --cnt[height[i]], height[i] = n;
+                    }
+                    newh = n;
+                }
+                height[v] = newh;
+                if (newh >= n) break;
+                ++cnt[newh];
+                highest = newh;
+                continue;
+            }
+
+            int w = g.to[e];
+            if (g.cap[e] != T(0) && height[v] == height[w] + 1){
+                // Push
+                T d = excess[v] < g.cap[e] ? excess[v] : g.cap[e];
+                if (excess[w] == T(0) && w != sink) bucket[height[w]].push_back(w);
+                g.cap[e] -= d;
+                g.cap[g.rev[e]] += d;
+                excess[v] -= d;
+                excess[w] += d;
+            }else{
+                ++e;
+            }
+        }
+
+        if (relabels >= n){
+            relabels = 0;
+            highest = GlobalRelabel(g,source,sink,excess,height,cnt,bucket);
+        }
+    }
+    return excess[sink];
+}
+
+
+//********************************************************
+//          Hopcroft-Karp Bipartite Matching
+//********************************************************
+
+// Bipartite graph stored in CSR form, only the adjacency indices and the match arrays are kept
+// The neighbors (right indices) of left vertex i are adj[head[i]], ..., adj[head[i+1]-1]
+struct BipartiteGraph{
+    int nl, nr;
+    vector<int> head, adj;
+    vector<int> left, right;      // the original vertex ids of the left / right vertices
+    vector<int> matchl, matchr;   // matchl[i] is the right index matched to left i, -1 if free
+
+    // working buffers of HopcroftKarp
+    vector<int> dist, cur, queue, stack;
+};
+
+
+// Construct the bipartite graph given the (left, right) index pairs of its edges
+void BuildBipartiteGraph(BipartiteGraph& bg, int nl, int nr, const vector<pair<int,int>>& edges){
+    bg.nl = nl, bg.nr = nr;
+    bg.head.assign(nl+1,0);
+    for (const pair<int,int>& e: edges) ++bg.head[e.first+1];
+    for (int i=0;i<nl;++i) bg.head[i+1] += bg.head[i];
+    bg.adj.resize(edges.size());
+    vector<int> pos(bg.head.begin(),bg.head.end()-1);
+    for (const pair<int,int>& e: edges) bg.adj[pos[e.first]++] = e.second;
+    if ((int)bg.left.size() != nl){
+        bg.left.resize(nl);
+        for (int i=0;i<nl;++i) bg.left[i] = i;
+    }
+    if ((int)bg.right.size() != nr){
+        bg.right.resize(nr);
+        for (int i=0;i<nr;++i) bg.right[i] = i;
+    }
+}
+
+
+// Recognize the network (graph, capacity) as a unit-capacity bipartite matching network:
+// the source has unit edges to the left vertices, the right vertices have unit edges to the sink,
+// and all other edges go from the left to the right. Edges into the source, edges out of the sink,
+// self-cycles, edges out of a vertex without incoming edges and edges into a vertex without
+// outgoing edges carry no flow and are ignored
+// return false if the network is not of this form, otherwise build the bipartite graph in bg
+template<class T>
+bool UnitBipartite(const vector<vector<int>>& graph, const vector<vector<T>>& capacity,
+                    int source, int sink, BipartiteGraph& bg){
     int n = graph.size();
-    vector<vector<T>> flow(n);
-    vector<typename list<struct edge<T>>::iterator> path;
+    if (source == sink) return false;
+    // side[i] = 1 for left vertices, 2 for right vertices, 0 otherwise
+    vector<int> side(n,0), id(n,-1);
+    bg.left.clear(), bg.right.clear();
+    for (int j=0,deg=graph[source].size();j<deg;++j){
+        int v = graph[source][j];
+        if (v == source) continue;
+        if (v == sink || side[v] || capacity[source][j] != T(1)) return false;
+        side[v] = 1, id[v] = bg.left.size();
+        bg.left.push_back(v);
+    }
     for (int i=0;i<n;++i){
-        flow[i] = vector<T>(graph[i].size());
-    }
-
-    bool flg = 1;
-    while (flg){ // Phase
-        flg = 0;
-        // Create Level Graph of the Residual Graph
-        vector<list<struct edge<T>>> levelgraph = ResidualGraph(graph,capacity,flow);
-        LevelGraph(levelgraph,source,sink); // Convert the residual graph to level graph
-        
-        while (1){
-            // DFS
-            DFSHandler<T>(levelgraph,path,source,sink);
-            if (path.empty()) break;
-            flg = 1;
-
-            T maxflow = path[0]->val;
-            for (typename list<struct edge<T>>::iterator e: path){
-                maxflow = min(maxflow, e->val);
-            }
- 
-            // Augment
-            int start = source;
-            for (typename list<struct edge<T>>::iterator e: path){
-                if (e->id >= 0){
-                    // it is not a reverse edge
-                    flow[start][e->id] += maxflow;
-
-                    // update level graph
-                    // (reverse edge is not in level graph in this case)
-                    e->val -= maxflow;
-                }else{
-                    // it is a reverse edge
-                    flow[e->next][-e->id - 1] -= maxflow;
+        if (i == source || i == sink) continue;
+        for (int v: graph[i]){
+            if (v != sink) continue;
+            if (side[i]) return false; // a left vertex linked to the sink, or a duplicated edge
+            side[i] = 2, id[i] = bg.right.size();
+            bg.right.push_back(i);
+        }
+    }
+    vector<char> hasin(n,0), hasout(n,0);
+    for (int i=0;i<n;++i){
+        for (int v: graph[i]){
+            if (v != i) hasout[i] = hasin[v] = 1;
+        }
+    }
+    vector<pair<int,int>> edges;
+    for (int i=0;i<n;++i){
+        if (i == source || i == sink || !hasin[i]) continue;
+        for (int j=0,deg=graph[i].size();j<deg;++j){
+            int v = graph[i][j];
+            if (v == i || v == source || (v != sink && !hasout[v])) continue;
+            if (v == sink){
+                if (capacity[i][j] != T(1)) return false;
+            }else if (side[i] == 1 && side[v] == 2){
+                if (capacity[i][j] != T(1)) return false;
+                edges.push_back(make_pair(id[i],id[v]));
+            }else{
+                return false;
+            }
+        }
+    }
+    BuildBipartiteGraph(bg,bg.left.size(),bg.right.size(),edges);
+    return true;
+}
 
-                    // update level graph
-                    // (forward edge is not in level graph in this case)
-                    e->val += maxflow;
-                }
-                start = e->next;
+
+// @brief Perform Hopcroft-Karp algorithm on the bipartite graph
+// The matching is written to bg.matchl and bg.matchr
+// @return the size of the maximum matching
+int HopcroftKarp(BipartiteGraph& bg){
+    int nl = bg.nl;
+    bg.matchl.assign(nl,-1);
+    bg.matchr.assign(bg.nr,-1);
+    bg.dist.resize(nl);
+    bg.cur.resize(nl);
+    bg.queue.resize(nl);
+    bg.stack.resize(nl);
+    int ans = 0;
+    while (1){
+        // BFS from the free left vertices, dist[i] is the number of matched edges to reach left i
+        int qhead = 0, qtail = 0;
+        for (int i=0;i<nl;++i){
+            bg.dist[i] = -1;
+            if (bg.matchl[i] < 0) bg.dist[i] = 0, bg.queue[qtail++] = i;
+        }
+        bool found = false;
+        while (qhead < qtail){
+            int i = bg.queue[qhead++];
+            for (int e=bg.head[i];e<bg.head[i+1];++e){
+                int w = bg.matchr[bg.adj[e]];
+                if (w < 0) found = true;
+                else if (bg.dist[w] < 0) bg.dist[w] = bg.dist[i] + 1, bg.queue[qtail++] = w;
             }
-        } 
-    }    
-    
-    // print the flow
-    //for (int i=0;i<n;++i) for (int j=graph[i].size()-1;j>=0;--j) 
-    //  if (flow[i][j]) cout << (i+1) << "->" << (graph[i][j]+1) << ": " << flow[i][j] <<'\n';
+        }
+        if (!found) break;
 
-    T ans(0);
-    for (T out: flow[source]){
-        if (out) ans += out;
+        // DFS from every free left vertex on an explicit stack along the current arcs,
+        // augment the path as soon as it reaches a free right vertex
+        for (int i=0;i<nl;++i) bg.cur[i] = bg.head[i];
+        for (int root=0;root<nl;++root){
+            if (bg.matchl[root] >= 0) continue;
+            int d = 0;
+            bg.stack[0] = root;
+            while (d >= 0){
+                int i = bg.stack[d];
+                int& e = bg.cur[i];
+                if (e == bg.head[i+1]){
+                    bg.dist[i] = -1; // dead end
+                    if (--d >= 0) ++bg.cur[bg.stack[d]];
+                    continue;
+                }
+                int w = bg.matchr[bg.adj[e]];
+                if (w < 0){
+                    // Augment
+                    for (;d>=0;--d){
+                        int u = bg.stack[d], v = bg.adj[bg.cur[u]];
+                        bg.matchl[u] = v;
+                        bg.matchr[v] = u;
+                    }
+                    ++ans;
+                }else if (bg.dist[w] == bg.dist[i] + 1){
+                    bg.stack[++d] = w;
+                }else{
+                    ++e;
+                }
+            }
+        }
     }
     return ans;
 }
 
-// Luogu P3376
-long long merge[205][205]; // 合并重边 (不合并亦可)
-int main(){
-    int n,m,s,t;
-    ios::sync_with_stdio(false);
-    //freopen("D:\\CppProjects\\LuoGu\\P3376_9.in","r",stdin);
-    cin >> n >> m >> s >> t;
-    --s, --t;
-    vector<vector<int>> graph(n);
-    vector<vector<long long>> capacity(n);
-    int u,v;
-    long long w;
-    for (int i=0;i<m;++i){
-        cin >> u >> v >> w;
-        --u, --v;
-        merge[u][v] += w;
-        graph[u].push_back(v);
-        capacity[u].push_back(w);
-    }
-    
+
+// @brief Compute max flow with the fastest applicable solver: Hopcroft-Karp if the network is
+// a unit-capacity bipartite matching network (see UnitBipartite), otherwise Dinic
+// @param matching: if it is not null and Hopcroft-Karp is used, the matched edges are written
+//                  to it as pairs of the original vertex ids
+// @return the value of max flow, which is the same as Dinic(graph, capacity, source, sink)
+template<class T>
+T MaxFlow(vector<vector<int>>& graph, vector<vector<T>>& capacity, int source, int sink,
+            vector<pair<int,int>>* matching = nullptr, int threads = 1){
+    BipartiteGraph bg;
+    if (!UnitBipartite(graph,capacity,source,sink,bg)) return Dinic(graph,capacity,source,sink,threads);
+    int ans = HopcroftKarp(bg);
+    if (matching){
+        matching->clear();
+        for (int i=0;i<bg.nl;++i){
+            if (bg.matchl[i] >= 0) matching->push_back(make_pair(bg.left[i],bg.right[bg.matchl[i]]));
+        }
+    }
+    return T(ans);
+}
+
+
+//********************************************************
+//                  Gomory-Hu Tree
+//********************************************************
+
+// Gomory-Hu tree of an undirected network built by Gusfield's algorithm with n-1 max flows
+// For any pair u, v the min cut between them equals the minimum weight on the tree path,
+// and removing that tree edge splits the vertices into the two sides of a min cut
+// Usage:
+//      GomoryHuTree<long long> tree(graph, capacity);
+//      tree.min_cut(u, v);         // O(log n)
+//      tree.min_cut_side(u, v);    // the vertices on the side of u, O(n)
+template<class T>
+class GomoryHuTree{
+    vector<int> depth;
+    vector<vector<int>> up;   // up[k][i] is the 2^k-th ancestor of i
+    vector<vector<T>> low;    // low[k][i] is the minimum weight on the path from i to up[k][i]
+
+public:
+    int n;
+    // the tree edge between i and parent[i] has weight weight[i], the root 0 has parent -1
+    vector<int> parent;
+    vector<T> weight;
+
+    // @param graph, capacity: the undirected network, every edge graph[i][j] can be used in both
+    //                         directions with capacity[i][j], duplicated edges are permitted
+    // @param threads: Number of threads used by the BFS of each max flow
+    GomoryHuTree(const vector<vector<int>>& graph, const vector<vector<T>>& capacity, int threads = 1){
+        n = graph.size();
+        parent.assign(n,0);
+        weight.assign(n,T(0));
+        if (n == 0) return;
+
+        vector<int> eu, ev, arc;
+        vector<T> ec;
+        for (int i=0;i<n;++i){
+            for (int j=0,deg=graph[i].size();j<deg;++j){
+                eu.push_back(i), ev.push_back(graph[i][j]), ec.push_back(capacity[i][j]);
+            }
+        }
+        ResidualGraph<T> g;
+        BuildResidualGraph(g,n,eu,ev,ec,arc);
+        for (int k=0,m=eu.size();k<m;++k){
+            if (arc[k] >= 0) g.cap[g.rev[arc[k]]] = ec[k];
+        }
+        vector<T> cap0(g.cap);
+
+        // Gusfield's algorithm, every iteration reuses the residual graph reset to zero flow
+        for (int s=1;s<n;++s){
+            int t = parent[s];
+            g.cap = cap0;
+            T f = Dinic(g,s,t,threads);
+            // after the last phase, level[i] != 0 iff i is on the side of s of the min cut
+            for (int i=0;i<n;++i){
+                if (i != s && g.level[i] && parent[i] == t) parent[i] = s;
+            }
+            weight[s] = f;
+            if (g.level[parent[t]]){
+                parent[s] = parent[t];
+                parent[t] = s;
+                weight[s] = weight[t];
+                weight[t] = f;
+            }
+        }
+        parent[0] = -1; // vertex 0 is never moved below another vertex, so it stays the root
+        build_lifting();
+    }
+
+    // the value of the min cut between u and v (u != v)
+    T min_cut(int u,int v) const{
+        T ans = numeric_limits<T>::max();
+        if (depth[u] < depth[v]) swap(u,v);
+        for (int k=up.size()-1;k>=0;--k){
+            if (depth[u] - (1<<k) >= depth[v]) ans = min(ans,low[k][u]), u = up[k][u];
+        }
+        if (u == v) return ans;
+        for (int k=up.size()-1;k>=0;--k){
+            if (up[k][u] != up[k][v]){
+                ans = min(ans,min(low[k][u],low[k][v]));
+                u = up[k][u], v = up[k][v];
+            }
+        }
+        return min(ans,min(low[0][u],low[0][v]));
+    }
+
+    // the vertices on the side of u of a min cut between u and v (u != v)
+    vector<int> min_cut_side(int u,int v) const{
+        // find the lightest edge (x, parent[x]) on the tree path
+        T best = numeric_limits<T>::max();
+        int cut = -1;
+        for (int a=u,b=v;a!=b;){
+            int& x = depth[a] >= depth[b] ? a : b;
+            if (cut < 0 || weight[x] < best) best = weight[x], cut = x;
+            x = parent[x];
+        }
+        // the subtree of cut is one side, mark it by walking every vertex up to cut or the root
+        vector<int> mark(n,-1); // 1 if in the subtree of cut, 0 otherwise
+        mark[cut] = 1;
+        mark[0] = 0;
+        vector<int> path;
+        for (int i=0;i<n;++i){
+            int x = i;
+            while (mark[x] < 0) path.push_back(x), x = parent[x];
+            for (int y: path) mark[y] = mark[x];
+            path.clear();
+        }
+        bool inside = mark[u];
+        vector<int> side;
+        for (int i=0;i<n;++i){
+            if ((bool)mark[i] == inside) side.push_back(i);
+        }
+        return side;
+    }
+
+private:
+    void build_lifting(){
+        depth.assign(n,-1);
+        depth[0] = 0;
+        vector<int> path;
+        for (int i=0;i<n;++i){
+            int x = i;
+            while (depth[x] < 0) path.push_back(x), x = parent[x];
+            for (int k=path.size()-1;k>=0;--k) depth[path[k]] = depth[parent[path[k]]] + 1;
+            path.clear();
+        }
+        int LOG = 1;
+        while ((1<<LOG) < n) ++LOG;
+        up.assign(LOG,vector<int>(n,0));
+        low.assign(LOG,vector<T>(n,numeric_limits<T>::max()));
+        for (int i=1;i<n;++i) up[0][i] = parent[i], low[0][i] = weight[i];
+        for (int k=1;k<LOG;++k){
+            for (int i=0;i<n;++i){
+                up[k][i] = up[k-1][up[k-1][i]];
+                low[k][i] = min(low[k-1][i],low[k-1][up[k-1][i]]);
+            }
+        }
+    }
+};
+
+
+//********************************************************
+//                  Edge List Loader
+//********************************************************
+
+// Buffered reader of integers, the input is read in large blocks by fread
+// and the integers are parsed in place from the block without copying
+class IntReader{
+    FILE* file;
+    vector<char> buf;
+    size_t pos = 0, len = 0;
+
+    inline int next(){
+        if (pos == len){
+            len = fread(buf.data(),1,buf.size(),file);
+            pos = 0;
+            if (len == 0) return EOF;
+        }
+        return buf[pos++];
+    }
+
+public:
+    IntReader(FILE* _file,size_t size = 1<<20):file(_file),buf(size){}
+
+    // read the next (signed) integer into x, return false at the end of the input
+    template<class I>
+    bool read(I& x){
+        int c = next();
+        while (c != EOF && c != '-' && (c < '0' || c > '9')) c = next();
+        if (c == EOF) return false;
+        bool neg = (c == '-');
+        if (neg) c = next();
+        x = I(0);
+        for (;c >= '0' && c <= '9';c = next()) x = x*10 + (c-'0');
+        if (neg) x = -x;
+        return true;
+    }
+};
+
+
+// Read m edges "u v w" (1-indexed) from the input and build the residual graph of
+// the network with n vertices directly, without the adjacency lists
+// Duplicated edges (u, v) are merged into a single edge whose capacity is the sum,
+// by a counting sort on u and a sort on v inside every row, in O(m log m) time and O(n + m) memory
+template<class T>
+void ReadNetwork(IntReader& in, int n, int m, ResidualGraph<T>& g){
+    vector<int> eu(m), ev(m);
+    vector<T> ec(m);
+    for (int k=0;k<m;++k){
+        in.read(eu[k]);
+        in.read(ev[k]);
+        in.read(ec[k]);
+        --eu[k], --ev[k];
+    }
+
+    // counting sort the edges by u
+    vector<int> start(n+1,0);
+    for (int k=0;k<m;++k) ++start[eu[k]+1];
+    for (int i=0;i<n;++i) start[i+1] += start[i];
+    {
+        vector<int> pos(start.begin(),start.end()-1), sv(m);
+        vector<T> sc(m);
+        for (int k=0;k<m;++k){
+            int j = pos[eu[k]]++;
+            sv[j] = ev[k], sc[j] = ec[k];
+        }
+        ev.swap(sv);
+        ec.swap(sc);
+    }
+
+    // sort every row by v and merge the duplicated edges,
+    // the merged edges are written in place since they never pass the row being read
+    vector<pair<int,T>> row;
+    int cnt = 0;
+    for (int i=0;i<n;++i){
+        row.clear();
+        for (int j=start[i];j<start[i+1];++j) row.push_back(make_pair(ev[j],ec[j]));
+        sort(row.begin(),row.end(),[](const pair<int,T>& a,const pair<int,T>& b){ return a.first < b.first;});
+        for (int j=0,sz=row.size();j<sz;++j){
+            if (j && row[j].first == row[j-1].first){
+                ec[cnt-1] += row[j].second;
+            }else{
+                eu[cnt] = i, ev[cnt] = row[j].first, ec[cnt] = row[j].second;
+                ++cnt;
+            }
+        }
+    }
+    eu.resize(cnt), ev.resize(cnt), ec.resize(cnt);
+
+    vector<int> arc;
+    BuildResidualGraph(g,n,eu,ev,ec,arc);
+}
+
+
+//********************************************************
+//                      Benchmark
+//********************************************************
+
+// A network for the benchmark, the vertices 0 and 1 are the source and the sink
+struct Network{
+    vector<vector<int>> graph;
+    vector<vector<long long>> capacity;
+
+    Network(int n):graph(n),capacity(n){}
+    void add(int u,int v,long long c){ graph[u].push_back(v), capacity[u].push_back(c);}
+    long long edges() const{
+        long long m = 0;
+        for (const vector<int>& adj: graph) m += adj.size();
+        return m;
+    }
+};
+
+
+// Random layered network: 16 layers with out-degree 8 between consecutive layers
+Network LayeredNetwork(long long m,mt19937& rng){
+    const int layers = 16, deg = 8;
+    int width = max(2LL,m / (layers * deg));
+    Network net(2 + layers * width);
+    auto id = [&](int l,int i){ return 2 + l * width + i;};
+    for (int i=0;i<width;++i) net.add(0,id(0,i),1000), net.add(id(layers-1,i),1,1000);
+    for (int l=0;l+1<layers;++l){
+        for (int i=0;i<width;++i){
+            for (int k=0;k<deg;++k) net.add(id(l,i),id(l+1,rng()%width),1 + rng()%100);
+        }
+    }
+    return net;
+}
+
+
+// Grid network as in vision (image segmentation): every pixel is linked to its 4 neighbors,
+// the source to the left column and the right column to the sink
+Network GridNetwork(long long m,mt19937& rng){
+    int side = max(2LL,(long long)sqrt((double)m / 4));
+    Network net(2 + side * side);
+    auto id = [&](int r,int c){ return 2 + r * side + c;};
+    for (int r=0;r<side;++r){
+        net.add(0,id(r,0),1000);
+        net.add(id(r,side-1),1,1000);
+        for (int c=0;c<side;++c){
+            if (r+1 < side) net.add(id(r,c),id(r+1,c),1 + rng()%100), net.add(id(r+1,c),id(r,c),1 + rng()%100);
+            if (c+1 < side) net.add(id(r,c),id(r,c+1),1 + rng()%100), net.add(id(r,c+1),id(r,c),1 + rng()%100);
+        }
+    }
+    return net;
+}
+
+
+// Unit-capacity bipartite matching network with average degree 8
+Network BipartiteNetwork(long long m,mt19937& rng){
+    int half = max(2LL,m / 8);
+    Network net(2 + 2 * half);
+    for (int i=0;i<half;++i) net.add(0,2+i,1), net.add(2+half+i,1,1);
+    for (long long k=0;k<m;++k) net.add(2 + rng()%half,2 + half + rng()%half,1);
+    return net;
+}
+
+
+// Adversarial network for Dinic: a chain v_0 (source), v_1, ..., v_k where every v_i has a unit
+// edge to the sink, so there are k phases and the i-th phase augments along a path of length i
+Network AKNetwork(long long m,mt19937& rng){
+    int k = max(2LL,m / 2);
+    Network net(k + 2);
+    for (int i=0;i<k;++i){
+        int v = i ? i + 1 : 0, next = i + 2;
+        net.add(v,next,k);
+        net.add(v,1,1 + rng()%2);
+    }
+    return net;
+}
+
+
+// Dense complete network
+Network DenseNetwork(long long m,mt19937& rng){
+    int n = max(3LL,(long long)sqrt((double)m) + 1);
+    Network net(n);
     for (int i=0;i<n;++i){
         for (int j=0;j<n;++j){
-            if (merge[i][j]){
-                graph[i].push_back(j);
-                capacity[i].push_back(merge[i][j]);
+            if (i != j) net.add(i,j,1 + rng()%1000000);
+        }
+    }
+    return net;
+}
+
+
+typedef Network (*Generator)(long long,mt19937&);
+
+struct BenchResult{
+    long long flow, edges;
+    double seconds;
+    long peak_rss_kb;   // -1 if not measured
+};
+
+// Generate a network and run one solver on it
+// solver: 0 = dinic, 1 = dinic_mt, 2 = push_relabel, 3 = auto
+BenchResult SolveOnce(Generator generator,long long m,unsigned seed,int solver,int threads){
+    mt19937 rng(seed);
+    Network net = generator(m,rng);
+    auto start = chrono::steady_clock::now();
+    long long flow;
+    if (solver == 0) flow = Dinic(net.graph,net.capacity,0,1);
+    else if (solver == 1) flow = Dinic(net.graph,net.capacity,0,1,threads);
+    else if (solver == 2) flow = PushRelabel(net.graph,net.capacity,0,1);
+    else flow = MaxFlow(net.graph,net.capacity,0,1);
+    BenchResult r = {flow,net.edges(),chrono::duration<double>(chrono::steady_clock::now() - start).count(),-1};
+    return r;
+}
+
+// SolveOnce in a forked child, which reports through a pipe
+// The high-water mark ru_maxrss of a process never decreases, so each measurement gets its own process
+// and wait4 returns the peak resident memory of that child alone
+// Without fork (e.g. on Windows) the solver runs in this process and the memory is not measured
+// return whether the run finished normally
+bool RunBenchmark(Generator generator,long long m,unsigned seed,int solver,int threads,BenchResult& result){
+#ifndef MAXFLOW_POSIX
+    result = SolveOnce(generator,m,seed,solver,threads);
+    return true;
+#else
+    int fd[2];
+    if (pipe(fd) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0){
+        close(fd[0]), close(fd[1]);
+        return false;
+    }
+    if (pid == 0){
+        close(fd[0]);
+        BenchResult r = SolveOnce(generator,m,seed,solver,threads);
+        bool ok = write(fd[1],&r,sizeof r) == (ssize_t)sizeof r;
+        _exit(ok ? 0 : 1);
+    }
+    close(fd[1]);
+    bool ok = read(fd[0],&result,sizeof result) == (ssize_t)sizeof result;
+    close(fd[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid,&status,0,&usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+    result.peak_rss_kb = usage.ru_maxrss;
+    return ok;
+#endif
+}
+
+// Time every solver on every family of networks with 10^3, 10^4, ... , maxedges edges,
+// print a CSV table with the throughput and the peak resident memory of each run
+// (the generated network included, left empty where it cannot be measured), and check that
+// all the solvers agree on the flow value
+// The quadratic AK family stops at 10^4 edges
+// return whether all the solvers agree
+bool Benchmark(long long maxedges,unsigned seed){
+    const char* names[] = {"layered","grid","bipartite","ak","dense"};
+    Generator generators[] = {LayeredNetwork,GridNetwork,BipartiteNetwork,AKNetwork,DenseNetwork};
+    const char* solvers[] = {"dinic","dinic_mt","push_relabel","auto"};
+    int threads = max(2u,thread::hardware_concurrency());
+    bool agree = true;
+
+    cout << "family,edges,solver,flow,seconds,edges_per_second,peak_rss_kb\n";
+    for (int f=0;f<5;++f){
+        for (long long m=1000;m<=maxedges;m*=10){
+            if (f == 3 && m > 10000) break;
+            long long expected = 0;
+            for (int k=0;k<4;++k){
+                BenchResult r;
+                if (!RunBenchmark(generators[f],m,seed,k,threads,r)){
+                    cerr << "FAILED: " << names[f] << " with about " << m << " edges, " << solvers[k] << endl;
+                    agree = false;
+                    continue;
+                }
+                cout << names[f] << ',' << r.edges << ',' << solvers[k] << ',' << r.flow << ',' << r.seconds
+                     << ',' << r.edges / max(r.seconds,1e-9) << ',';
+                if (r.peak_rss_kb >= 0) cout << r.peak_rss_kb;
+                cout << endl;
+                if (k == 0) expected = r.flow;
+                else if (r.flow != expected){
+                    cerr << "MISMATCH: " << names[f] << " with " << r.edges << " edges, "
+                         << solvers[k] << " returns " << r.flow << " but dinic returns " << expected << endl;
+                    agree = false;
+                }
             }
         }
     }
-    
-    cout << Dinic(graph,capacity,s,t);
+    return agree;
+}
+
+
+// Luogu P3376
+// Run with the argument --stats to dump the statistics of Dinic as JSON to stderr
+// Run with the arguments --bench [maxedges] [seed] to run the benchmark instead
+int main(int argc,char** argv){
+    if (argc > 1 && string(argv[1]) == "--bench"){
+        long long maxedges = argc > 2 ? atoll(argv[2]) : 1000000;
+        unsigned seed = argc > 3 ? atoi(argv[3]) : 2023;
+        return Benchmark(maxedges,seed) ? 0 : 1;
+    }
+    int n,m,s,t;
+    //freopen("D:\\CppProjects\\LuoGu\\P3376_9.in","r",stdin);
+    IntReader in(stdin);
+    in.read(n), in.read(m), in.read(s), in.read(t);
+    --s, --t;
+    ResidualGraph<long long> g;
+    ReadNetwork(in,n,m,g);
+    if (argc > 1 && string(argv[1]) == "--stats"){
+        FlowStats stats;
+        cout << Dinic(g,s,t,1,stats);
+        stats.print_json(cerr);
+        cerr << endl;
+        return 0;
+    }
+    cout << Dinic(g,s,t);
     return 0;
 }
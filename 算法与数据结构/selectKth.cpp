@@ -2,49 +2,411 @@
 #include<algorithm>
 #include<vector>
 #include<random>
+#include<type_traits>
+#include<math.h>
 #include<time.h>
+#include<stdint.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SELECT_X86_SIMD
+#include<immintrin.h>
+#endif
 using namespace std;
 
-//将 vec[left: right) 中小于 x 的数放在数组左侧，大于等于 x 的数放在数组右侧
-//返回小于 x 的数的个数
+//对 vec[left: right) 做插入排序，用于很短的区间
+template<class T>
+inline void insertionSort_(typename vector<T>::iterator left,typename vector<T>::iterator right){
+    for (typename vector<T>::iterator i = left+1; i < right; ++i){
+        T x = *i;
+        typename vector<T>::iterator j = i;
+        for (; j > left && x < *(j-1); --j) *j = *(j-1);
+        *j = x;
+    }
+}
+
+//以 *pivot 为基准三路划分 vec[left: right) (Bentley-McIlroy)，返回 [lo, hi)：
+//vec[left: lo) 中的数 < x，vec[lo: hi) 中的数 == x，vec[hi: right) 中的数 > x
+//扫描时把与基准相等的数交换到区间两端，最后再换到中间；相等的数不多时几乎没有额外的交换
+//只用到 operator<，要求 right - left >= 2
 //注：C++ STL 有现成的 partition函数
 template<class T>
-inline int partition_(typename vector<T>::iterator left,typename vector<T>::iterator right,T x){
-    typename vector<T>::iterator l = left, aim;
-    --right;
-    while (left < right){
-        while (left < right && *left < x){
-            ++left;
+inline pair<typename vector<T>::iterator,typename vector<T>::iterator>
+partition_(typename vector<T>::iterator left,typename vector<T>::iterator right,typename vector<T>::iterator pivot){
+    typedef typename vector<T>::iterator It;
+    It r = right-1;
+    swap(*r,*pivot);
+    T x = *r;
+    It i = left, j = r, p = left, q = r;   //vec[left: p) 与 vec[q: r] 中的数 == x
+    while (true){
+        while (*i < x) ++i;                 //最多停在 r 处
+        do --j; while (j != left && x < *j);
+        if (i >= j) break;
+        swap(*i,*j);
+        if (!(*i < x)) swap(*p++,*i);
+        if (!(x < *j)) swap(*--q,*j);
+        ++i;
+    }
+    //此时 vec[p: i) 中的数 < x，vec[i: q) 中的数 >= x，其中只有 *i 可能 == x
+    if (i < q && !(x < *i)) swap(*i,*--q);
+    It lo = i, hi = i;
+    for (It k = left; k < p; ++k) swap(*k,*--lo);
+    for (It k = r; k >= q; --k) swap(*k,*hi++);
+    return make_pair(lo,hi);
+}
+
+//****************************************************************
+//   整数与浮点数的划分：分块无分支 (BlockQuicksort) 与 AVX2 / AVX-512
+//****************************************************************
+//下面的函数把 a[0: n) 中满足 pred(v) 的数放在前面，返回这些数的个数
+//le = false 时 pred(v) = v < x，le = true 时 pred(v) = v <= x
+
+//分块无分支划分：左右各取一块，无分支地记下放错位置的数的下标，再成对交换
+//对随机数据，比较的结果不再造成分支预测失败
+template<class T,bool le>
+long long partitionBlock_(T* a,long long n,T x){
+    const int B = 64;
+    unsigned char offl[B], offr[B];
+    int numl = 0, numr = 0, startl = 0, startr = 0;
+    T *l = a, *r = a+n;     //[a, l) 满足 pred，[r, a+n) 不满足，[l, r) 未处理完
+    while (r - l > 2*B){
+        if (numl == 0){
+            startl = 0;
+            for (int i=0;i<B;++i){
+                offl[numl] = i;
+                numl += le ? x < l[i] : !(l[i] < x);
+            }
         }
-        while (left < right && *right >= x){
-            --right;
+        if (numr == 0){
+            startr = 0;
+            for (int i=0;i<B;++i){
+                offr[numr] = i;
+                numr += le ? !(x < r[-1-i]) : r[-1-i] < x;
+            }
         }
-        swap(*left,*right);
+        int num = min(numl,numr);
+        for (int i=0;i<num;++i) swap(l[offl[startl+i]],r[-1-offr[startr+i]]);
+        numl -= num, numr -= num, startl += num, startr += num;
+        if (numl == 0) l += B;
+        if (numr == 0) r -= B;
+    }
+    //剩下不超过 2B 个数，用无分支的 Lomuto 划分
+    T* m = l;
+    for (T* i=l;i<r;++i){
+        T v = *i;
+        bool b = le ? !(x < v) : v < x;
+        *i = *m, *m = v, m += b;
     }
-    return left-l;
+    return m - a;
 }
 
-//返回 vec[left: right) 中从小到大第 k 个数 (1 <= k <= vec.size())
-template <class T>
-T selectKth(typename vector<T>::iterator left,typename vector<T>::iterator right,int k){
-    if (right - left <= 10){
-        sort(left,right);
-        return *(left+k-1);
+//按类型的种类选择划分：4 / 8 字节的有符号整数 (int, long, long long, int64_t 等) 各共用一份，
+//float 与 double 各一份，其余类型没有
+enum LaneKind_{ noLanes_, int32Lanes_, int64Lanes_, floatLanes_, doubleLanes_ };
+template<class T> struct laneKind_ : integral_constant<int,
+    is_same<T,float>::value ? floatLanes_ : is_same<T,double>::value ? doubleLanes_ :
+    !is_integral<T>::value || !is_signed<T>::value ? noLanes_ :
+    sizeof(T) == 4 ? int32Lanes_ : sizeof(T) == 8 ? int64Lanes_ : noLanes_>{};
+
+#ifdef SELECT_X86_SIMD
+//AVX2 没有 compress 指令，用 vpermd 代替：idx8[mask] 把 mask 中为 1 的 32 位 lane 排在前面，
+//其余排在后面；idx4 是 4 个 64 位 lane 的版本
+struct PermuteTable_{
+    int idx8[256][8], idx4[16][8];
+    PermuteTable_(){
+        for (int m=0;m<256;++m){
+            int c = 0;
+            for (int i=0;i<8;++i) if (m >> i & 1) idx8[m][c++] = i;
+            for (int i=0;i<8;++i) if (!(m >> i & 1)) idx8[m][c++] = i;
+        }
+        for (int m=0;m<16;++m){
+            int c = 0;
+            for (int i=0;i<4;++i) if (m >> i & 1) idx4[m][c++] = 2*i, idx4[m][c++] = 2*i+1;
+            for (int i=0;i<4;++i) if (!(m >> i & 1)) idx4[m][c++] = 2*i, idx4[m][c++] = 2*i+1;
+        }
+    }
+} permuteTable_;
+
+//每种类型的向量操作：mask<le>(v, x) 的第 i 位为 pred(v[i])，
+//split<le>(v, x, lw, rw) 把满足 pred 的 lane 写到 lw 起，其余写到 rw 之前，返回前者的个数；
+//两处都可能多写 L 个数以内的无用值，调用者保证这些位置是空闲的
+template<class T,int kind = laneKind_<T>::value> struct LanesAVX2;
+template<class T,int kind = laneKind_<T>::value> struct LanesAVX512;
+
+template<class T> struct LanesAVX2<T,int32Lanes_>{
+    typedef __m256i V;
+    static const int L = 8;
+    __attribute__((target("avx2"))) static V set1(T x){ return _mm256_set1_epi32(x); }
+    __attribute__((target("avx2"))) static V load(const T* p){ return _mm256_loadu_si256((const __m256i*)p); }
+    __attribute__((target("avx2"))) static __m256i bits(V v){ return v; }
+    template<bool le> __attribute__((target("avx2"))) static int mask(V v,V x){
+        return le ? ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v,x))) & 255
+                  : _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x,v)));
+    }
+};
+template<class T> struct LanesAVX2<T,int64Lanes_>{
+    typedef __m256i V;
+    static const int L = 4;
+    __attribute__((target("avx2"))) static V set1(T x){ return _mm256_set1_epi64x(x); }
+    __attribute__((target("avx2"))) static V load(const T* p){ return _mm256_loadu_si256((const __m256i*)p); }
+    __attribute__((target("avx2"))) static __m256i bits(V v){ return v; }
+    template<bool le> __attribute__((target("avx2"))) static int mask(V v,V x){
+        return le ? ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v,x))) & 15
+                  : _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x,v)));
     }
-    vector<T> medians;
-    typename vector<T>::iterator i;
-    for (i = left; right-i>=5; i+=5){
-        medians.push_back(selectKth<T>(i,i+5,3));
+};
+template<> struct LanesAVX2<float,floatLanes_>{
+    typedef __m256 V;
+    static const int L = 8;
+    __attribute__((target("avx2"))) static V set1(float x){ return _mm256_set1_ps(x); }
+    __attribute__((target("avx2"))) static V load(const float* p){ return _mm256_loadu_ps(p); }
+    __attribute__((target("avx2"))) static __m256i bits(V v){ return _mm256_castps_si256(v); }
+    template<bool le> __attribute__((target("avx2"))) static int mask(V v,V x){
+        return _mm256_movemask_ps(_mm256_cmp_ps(v,x,le ? _CMP_LE_OQ : _CMP_LT_OQ));
     }
-    if (i != right){
-        medians.push_back(selectKth<T>(i,right,(1+(int)(right-i))>>1));
+};
+template<> struct LanesAVX2<double,doubleLanes_>{
+    typedef __m256d V;
+    static const int L = 4;
+    __attribute__((target("avx2"))) static V set1(double x){ return _mm256_set1_pd(x); }
+    __attribute__((target("avx2"))) static V load(const double* p){ return _mm256_loadu_pd(p); }
+    __attribute__((target("avx2"))) static __m256i bits(V v){ return _mm256_castpd_si256(v); }
+    template<bool le> __attribute__((target("avx2"))) static int mask(V v,V x){
+        return _mm256_movemask_pd(_mm256_cmp_pd(v,x,le ? _CMP_LE_OQ : _CMP_LT_OQ));
     }
-    T x = selectKth<T>(medians.begin(),medians.end(),(1+medians.size())>>1);
+};
 
-    int part = partition_(left,right,x);
-    if (part >= k) return selectKth<T>(left,left+part,k);
-    else if (part < k) return selectKth<T>(left+part,right,k-part);
-    else return x; // part == k-1
+template<class T> struct LanesAVX512<T,int32Lanes_>{
+    typedef __m512i V;
+    static const int L = 16;
+    __attribute__((target("avx512f"))) static V set1(T x){ return _mm512_set1_epi32(x); }
+    __attribute__((target("avx512f"))) static V load(const T* p){ return _mm512_loadu_si512(p); }
+    template<bool le> __attribute__((target("avx512f"))) static int split(V v,V x,T* lw,T* rw){
+        __mmask16 m = _mm512_cmp_epi32_mask(v,x,le ? _MM_CMPINT_LE : _MM_CMPINT_LT);
+        int c = __builtin_popcount(m);
+        _mm512_storeu_si512(lw,_mm512_maskz_compress_epi32(m,v));
+        _mm512_mask_storeu_epi32(rw-(L-c),(1u<<(L-c))-1,_mm512_maskz_compress_epi32(~m,v));
+        return c;
+    }
+};
+template<class T> struct LanesAVX512<T,int64Lanes_>{
+    typedef __m512i V;
+    static const int L = 8;
+    __attribute__((target("avx512f"))) static V set1(T x){ return _mm512_set1_epi64(x); }
+    __attribute__((target("avx512f"))) static V load(const T* p){ return _mm512_loadu_si512(p); }
+    template<bool le> __attribute__((target("avx512f"))) static int split(V v,V x,T* lw,T* rw){
+        __mmask8 m = _mm512_cmp_epi64_mask(v,x,le ? _MM_CMPINT_LE : _MM_CMPINT_LT);
+        int c = __builtin_popcount(m);
+        _mm512_storeu_si512(lw,_mm512_maskz_compress_epi64(m,v));
+        _mm512_mask_storeu_epi64(rw-(L-c),(1u<<(L-c))-1,_mm512_maskz_compress_epi64(~m,v));
+        return c;
+    }
+};
+template<> struct LanesAVX512<float,floatLanes_>{
+    typedef __m512 V;
+    static const int L = 16;
+    __attribute__((target("avx512f"))) static V set1(float x){ return _mm512_set1_ps(x); }
+    __attribute__((target("avx512f"))) static V load(const float* p){ return _mm512_loadu_ps(p); }
+    template<bool le> __attribute__((target("avx512f"))) static int split(V v,V x,float* lw,float* rw){
+        __mmask16 m = _mm512_cmp_ps_mask(v,x,le ? _CMP_LE_OQ : _CMP_LT_OQ);
+        int c = __builtin_popcount(m);
+        _mm512_storeu_ps(lw,_mm512_maskz_compress_ps(m,v));
+        _mm512_mask_storeu_ps(rw-(L-c),(1u<<(L-c))-1,_mm512_maskz_compress_ps(~m,v));
+        return c;
+    }
+};
+template<> struct LanesAVX512<double,doubleLanes_>{
+    typedef __m512d V;
+    static const int L = 8;
+    __attribute__((target("avx512f"))) static V set1(double x){ return _mm512_set1_pd(x); }
+    __attribute__((target("avx512f"))) static V load(const double* p){ return _mm512_loadu_pd(p); }
+    template<bool le> __attribute__((target("avx512f"))) static int split(V v,V x,double* lw,double* rw){
+        __mmask8 m = _mm512_cmp_pd_mask(v,x,le ? _CMP_LE_OQ : _CMP_LT_OQ);
+        int c = __builtin_popcount(m);
+        _mm512_storeu_pd(lw,_mm512_maskz_compress_pd(m,v));
+        _mm512_mask_storeu_pd(rw-(L-c),(1u<<(L-c))-1,_mm512_maskz_compress_pd(~m,v));
+        return c;
+    }
+};
+
+//原地的向量划分：先把首尾各 L 个数复制到缓冲区，空出 2L 个位置；之后每次从空位较少的一侧读一个向量，
+//满足 pred 的 lane 写到左侧的空位，其余写到右侧的空位，两侧的空位始终都不少于 L 个。
+//最后把剩下的不到 L 个数也放进缓冲区，逐个无分支地写回
+template<class T,bool le> __attribute__((target("avx2")))
+long long partitionAVX2_(T* a,long long n,T x){
+    typedef LanesAVX2<T> Ln;
+    const int L = Ln::L;
+    if (n < 4*L) return partitionBlock_<T,le>(a,n,x);
+    const int* idx = L == 8 ? permuteTable_.idx8[0] : permuteTable_.idx4[0];
+    T buf[3*L];
+    copy(a,a+L,buf), copy(a+n-L,a+n,buf+L);
+    typename Ln::V xv = Ln::set1(x);
+    T *lr = a+L, *rr = a+n-L, *lw = a, *rw = a+n;
+    while (rr - lr >= L){
+        typename Ln::V v;
+        if (lr - lw <= rw - rr) v = Ln::load(lr), lr += L;
+        else rr -= L, v = Ln::load(rr);
+        int m = Ln::template mask<le>(v,xv), c = __builtin_popcount(m);
+        __m256i w = _mm256_permutevar8x32_epi32(Ln::bits(v),_mm256_loadu_si256((const __m256i*)(idx+8*m)));
+        _mm256_storeu_si256((__m256i*)lw,w);
+        _mm256_storeu_si256((__m256i*)(rw-L),w);
+        lw += c, rw -= L-c;
+    }
+    int rest = rr - lr;
+    copy(lr,rr,buf+2*L);
+    for (int i=0;i<2*L+rest;++i){
+        T v = buf[i];
+        bool b = le ? !(x < v) : v < x;
+        *lw = v, rw[-1] = v;
+        lw += b, rw -= !b;
+    }
+    return lw - a;
+}
+
+template<class T,bool le> __attribute__((target("avx512f")))
+long long partitionAVX512_(T* a,long long n,T x){
+    typedef LanesAVX512<T> Ln;
+    const int L = Ln::L;
+    if (n < 4*L) return partitionBlock_<T,le>(a,n,x);
+    T buf[3*L];
+    copy(a,a+L,buf), copy(a+n-L,a+n,buf+L);
+    typename Ln::V xv = Ln::set1(x);
+    T *lr = a+L, *rr = a+n-L, *lw = a, *rw = a+n;
+    while (rr - lr >= L){
+        typename Ln::V v;
+        if (lr - lw <= rw - rr) v = Ln::load(lr), lr += L;
+        else rr -= L, v = Ln::load(rr);
+        int c = Ln::template split<le>(v,xv,lw,rw);
+        lw += c, rw -= L-c;
+    }
+    int rest = rr - lr;
+    copy(lr,rr,buf+2*L);
+    for (int i=0;i<2*L+rest;++i){
+        T v = buf[i];
+        bool b = le ? !(x < v) : v < x;
+        *lw = v, rw[-1] = v;
+        lw += b, rw -= !b;
+    }
+    return lw - a;
+}
+#endif
+
+template<class T> struct PartitionKernel_{ typedef long long (*type)(T*,long long,T); };
+
+//选择 cpu 支持的最宽的划分
+template<class T,bool le>
+typename PartitionKernel_<T>::type selectPartitionKernel_(){
+#ifdef SELECT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return partitionAVX512_<T,le>;
+    if (__builtin_cpu_supports("avx2")) return partitionAVX2_<T,le>;
+#endif
+    return partitionBlock_<T,le>;
+}
+
+//4 / 8 字节的有符号整数与 float, double 用上面的划分，其他类型用三路划分
+template<class T> struct blockPartition_ : integral_constant<bool,laneKind_<T>::value != noLanes_>{};
+
+template<class T>
+inline pair<typename vector<T>::iterator,typename vector<T>::iterator>
+partition_(typename vector<T>::iterator left,typename vector<T>::iterator right,typename vector<T>::iterator pivot,false_type){
+    return partition_<T>(left,right,pivot);
+}
+
+//两路划分为 < x 与 >= x 两部分，基准放在两部分之间，返回 [m, m+1)；
+//若没有数 < x (x 是区间的最小值)，再把 >= x 的部分划分为 == x 与 > x，返回相等的一段，
+//所以重复的数很多时区间仍然很快缩小
+template<class T>
+inline pair<typename vector<T>::iterator,typename vector<T>::iterator>
+partition_(typename vector<T>::iterator left,typename vector<T>::iterator right,typename vector<T>::iterator pivot,true_type){
+    static const typename PartitionKernel_<T>::type less = selectPartitionKernel_<T,false>();
+    static const typename PartitionKernel_<T>::type lessEqual = selectPartitionKernel_<T,true>();
+    typename vector<T>::iterator r = right-1, m;
+    swap(*r,*pivot);
+    T x = *r;
+    m = left + less(&*left,r-left,x);
+    swap(*m,*r);
+    if (m != left) return make_pair(m,m+1);
+    return make_pair(m,m+1+lessEqual(&*(m+1),right-(m+1),x));
+}
+
+//返回 vec[left: right) 中从小到大第 k 个数 (1 <= k <= right - left)
+//introselect：每一层在 [left, right) 中找应当位于 aim 处的数，反复以基准三路划分并缩小区间，
+//aim 落在与基准相等的一段中即可结束，所以重复的数很多时也是线性的
+//4 / 8 字节的有符号整数与 float, double 的划分用分块无分支 / AVX2 / AVX-512 的版本，运行时按 cpu 选择
+//  长区间用 Floyd-Rivest 采样选基准：aim 附近约 n^(2/3) 个数的子区间中第 aim 小的数
+//  中等区间用三数取中
+//  若连续 3 次划分后区间没有缩小一半，则改用中位数的中位数 (每 5 个数的中位数移到区间前部)，
+//  保证最坏情况 O(n)
+//选基准需要先在子区间中选数，这里不递归，而是把子区间压入一个定长的栈：子区间至多是
+//原区间的 1/5，所以栈的深度不超过 log5(n) + 1。全程不分配内存
+template <class T>
+T selectKth(typename vector<T>::iterator left,typename vector<T>::iterator right,int k){
+    typedef typename vector<T>::iterator It;
+    struct Frame{
+        It left, right, aim;
+        It pivot;           //基准所在的位置
+        bool ready;         //基准是否已选好 (子区间已处理完)
+        long long mark;     //上次检查时的区间长度
+        int steps;          //上次检查后的划分次数
+        bool mom;           //是否改用中位数的中位数
+    };
+    const int small = 16, sampling = 600;
+    Frame stack[64];
+    int top = 0;
+    stack[0] = Frame{left,right,left+k-1,left,false,right-left,0,false};
+    while (true){
+        Frame& f = stack[top];
+        if (f.ready){
+            pair<It,It> m = partition_<T>(f.left,f.right,f.pivot,blockPartition_<T>());
+            f.ready = false;
+            if (f.aim >= m.first && f.aim < m.second){   //落在相等的一段中，不用再划分
+                if (top-- == 0) return *(left+k-1);
+                continue;
+            }
+            if (f.aim < m.first) f.right = m.first;
+            else f.left = m.second;
+            if (++f.steps == 3){
+                if (2 * (f.right - f.left) > f.mark) f.mom = true;
+                f.mark = f.right - f.left, f.steps = 0;
+            }
+        }
+        long long n = f.right - f.left;
+        if (n <= small){
+            insertionSort_<T>(f.left,f.right);
+            if (top-- == 0) return *(left+k-1);
+            continue;
+        }
+        Frame child;
+        if (f.mom){
+            //每 5 个数的中位数移到 f.left + g 处，再在这 n/5 个数中选中位数
+            long long groups = n / 5;
+            for (long long g=0;g<groups;++g){
+                It i = f.left + 5*g;
+                insertionSort_<T>(i,i+5);
+                swap(*(f.left+g),*(i+2));
+            }
+            f.pivot = f.left + groups/2;
+            child = Frame{f.left,f.left+groups,f.pivot,f.left,false,groups,0,false};
+        }else if (n > sampling){
+            //Floyd-Rivest：样本大小 s = n^(2/3) / 2，区间向 aim 偏移 sd 个标准差
+            long long i = f.aim - f.left;
+            double z = log((double)n), s = 0.5 * exp(2 * z / 3);
+            double sd = 0.5 * sqrt(z * s * (n - s) / n) * (2 * i < n ? -1 : 1);
+            long long l = max(0LL,(long long)(i - i * s / n + sd));
+            long long r = min(n,(long long)(i + (n - i) * s / n + sd) + 1);
+            f.pivot = f.aim;
+            child = Frame{f.left+l,f.left+r,f.aim,f.left,false,r-l,0,false};
+        }else{
+            //三数取中，放在区间中点
+            It a = f.left, b = f.left + n/2, c = f.right-1;
+            if (*b < *a) swap(*a,*b);
+            if (*c < *b) swap(*b,*c);
+            if (*b < *a) swap(*a,*b);
+            f.pivot = b, f.ready = true;
+            continue;
+        }
+        f.ready = true;
+        stack[++top] = child;
+    }
 }
 
 //返回 vec 中从小到大第 k 个数 (1 <= k <= vec.size())